@@ -17,6 +17,8 @@ for target in beta release; do
 	"$out_dir/realToStringShortest" > /dev/null
 	CPP_OPTIONS="-std=c++11" bash tools/BuildCpp.sh "$target" native "$out_dir/MakaronCmd" \
 		-I src tools/MakaronCmd.cpp src/Makaron.cpp
+	CPP_OPTIONS="-std=c++11" bash tools/BuildCpp.sh "$target" native "$out_dir/NumbstrictBenchmark" \
+		-I src tools/NumbstrictBenchmark.cpp src/Numbstrict.cpp
 done
 
 echo "Build and tests completed"
@@ -5,8 +5,27 @@
 #include <algorithm>
 #include <fstream>
 #include <cstring>
+#include <limits>
+#include <cstdint>
 #include "Makaron.h"
 
+// For mapFile().
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 /*
 	Roadmap:
  
@@ -44,12 +63,16 @@ const char* Exception::what() const throw() {
 }
 
 std::pair<int, int> calculateLineAndColumn(const String& text, size_t offset) {
+	return calculateLineAndColumn(SourceBuffer(text.data(), text.data() + text.size(), 0), offset);
+}
+
+std::pair<int, int> calculateLineAndColumn(const SourceBuffer& text, size_t offset) {
 	int line = 1;
 	int column = 1;
-	const StringIt b = text.begin();
+	const StringIt b = text.begin;
 	const StringIt e = b + offset;
 	for (StringIt p = b; p != e; ++p) {
-		assert(p != text.end());
+		assert(p != text.end);
 		if (*p == '\n') {
 			++line;
 			column = 0;
@@ -59,16 +82,206 @@ std::pair<int, int> calculateLineAndColumn(const String& text, size_t offset) {
 	return std::make_pair(line, column);
 }
 
+LineIndex::LineIndex(const StringIt& begin, const StringIt& end) {
+	lineStarts.push_back(0);
+	for (StringIt p = begin; p != end; ++p) {
+		if (*p == '\n') {
+			lineStarts.push_back(p + 1 - begin);
+		}
+	}
+}
+
+std::pair<int, int> LineIndex::find(size_t offset) const {
+	const size_t line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+	return std::make_pair(static_cast<int>(line), static_cast<int>(offset - lineStarts[line - 1] + 1));
+}
+
+#ifdef _WIN32
+typedef WideString SystemPath;	// opened with CreateFileW(), so any path can be mapped
+#else
+typedef String SystemPath;	// passed to open() as bytes, so wide paths are encoded as UTF-8
+
+static String encodeUTF8(const WideString& string) {
+	String encoded;
+	for (WideString::const_iterator it = string.begin(); it != string.end(); ++it) {
+		const uint32_t c = static_cast<uint32_t>(*it);
+		if (c < 0x80) {
+			encoded += static_cast<Char>(c);
+		} else if (c < 0x800) {
+			encoded += static_cast<Char>(0xC0 | (c >> 6));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		} else if (c < 0x10000) {
+			encoded += static_cast<Char>(0xE0 | (c >> 12));
+			encoded += static_cast<Char>(0x80 | ((c >> 6) & 0x3F));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		} else {
+			encoded += static_cast<Char>(0xF0 | (c >> 18));
+			encoded += static_cast<Char>(0x80 | ((c >> 12) & 0x3F));
+			encoded += static_cast<Char>(0x80 | ((c >> 6) & 0x3F));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		}
+	}
+	return encoded;
+}
+#endif
+
+/*
+	Reads what can't be mapped, i.e. pipes, terminals and other devices, and files that report no size (like the ones
+	in procfs). Regular empty files are read too, as they can't be mapped either.
+*/
+#ifdef _WIN32
+static bool readSystemFile(HANDLE file, SourceBuffer& buffer) {
+	const std::shared_ptr<String> contents = std::make_shared<String>();
+	Char chunk[16384];
+	while (true) {
+		DWORD count = 0;
+		if (ReadFile(file, chunk, sizeof (chunk), &count, 0) == 0) {
+			if (GetLastError() != ERROR_BROKEN_PIPE) {	// which is how the end of a pipe reads
+				return false;
+			}
+			break;
+		}
+		if (count == 0) {
+			break;
+		}
+		contents->append(chunk, count);
+	}
+	buffer = SourceBuffer(std::shared_ptr<const String>(contents));
+	return true;
+}
+#else
+static bool readSystemFile(int file, SourceBuffer& buffer) {
+	const std::shared_ptr<String> contents = std::make_shared<String>();
+	Char chunk[16384];
+	ssize_t count;
+	while ((count = read(file, chunk, sizeof (chunk))) != 0) {
+		if (count > 0) {
+			contents->append(chunk, static_cast<size_t>(count));
+		} else if (errno != EINTR) {
+			return false;
+		}
+	}
+	buffer = SourceBuffer(std::shared_ptr<const String>(contents));
+	return true;
+}
+#endif
+
+static bool mapSystemPath(const SystemPath& path, SourceBuffer& buffer) {
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING
+			, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	const bool isMappable = (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize) != 0
+			&& fileSize.QuadPart > 0);
+	if (!isMappable) {
+		const bool ok = readSystemFile(file, buffer);
+		CloseHandle(file);
+		return ok;
+	}
+	if (static_cast<uint64_t>(fileSize.QuadPart) > std::numeric_limits<size_t>::max()) {
+		CloseHandle(file);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(fileSize.QuadPart);
+	const HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	const void* const address = (mapping != 0 ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0);
+	if (mapping != 0) {
+		CloseHandle(mapping);	// the view keeps the mapping open
+	}
+	CloseHandle(file);
+	if (address == 0) {
+		return false;
+	}
+	buffer.owner = std::shared_ptr<const void>(address, [](const void* p) { UnmapViewOfFile(p); });
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		return false;
+	}
+	if (!S_ISREG(status.st_mode) || status.st_size <= 0) {
+		const bool ok = readSystemFile(file, buffer);
+		close(file);
+		return ok;
+	}
+	if (static_cast<uint64_t>(status.st_size) > std::numeric_limits<size_t>::max()) {
+		close(file);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(status.st_size);
+	void* const address = mmap(0, size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);	// the mapping keeps the file open
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	buffer.owner = std::shared_ptr<const void>(address, [size](const void* p) {
+		munmap(const_cast<void*>(p), size);
+	});
+#endif
+	buffer.begin = static_cast<const Char*>(address);
+	buffer.end = buffer.begin + size;
+	return true;
+}
+
+bool mapFile(const String& fileName, SourceBuffer& buffer) {
+#ifdef _WIN32
+	const int length = static_cast<int>(fileName.size());	// in the ANSI code page, like for CreateFileA()
+	const int wideLength = MultiByteToWideChar(CP_ACP, 0, fileName.data(), length, 0, 0);
+	WideString wideFileName(wideLength, 0);
+	if (length != 0 && (wideLength == 0
+			|| MultiByteToWideChar(CP_ACP, 0, fileName.data(), length, &wideFileName[0], wideLength) == 0)) {
+		return false;
+	}
+	return mapSystemPath(wideFileName, buffer);
+#else
+	return mapSystemPath(fileName, buffer);
+#endif
+}
+
+bool mapFile(const WideString& fileName, SourceBuffer& buffer) {
+#ifdef _WIN32
+	return mapSystemPath(fileName, buffer);
+#else
+	return mapSystemPath(encodeUTF8(fileName), buffer);
+#endif
+}
+
 Span::Span(const String& sourceCode, const WideString& fileName)
 	: source(std::make_shared<const String>(sourceCode))
 	, file(std::make_shared<const WideString>(fileName))
-	, begin(source->begin())
-	, end(source->end()) {
+	, lines(std::make_shared<std::shared_ptr<const LineIndex> >())
+	, begin(source.begin)
+	, end(source.end) {
+}
+
+Span::Span(const SourceBuffer& sourceBuffer, const WideString& fileName)
+	: source(sourceBuffer)
+	, file(std::make_shared<const WideString>(fileName))
+	, lines(std::make_shared<std::shared_ptr<const LineIndex> >())
+	, begin(source.begin)
+	, end(source.end) {
+}
+
+std::pair<int, int> Span::lineAndColumn(const StringIt& p) const {
+	assert(p >= source.begin && p <= source.end);
+	std::shared_ptr<const LineIndex> index = std::atomic_load(lines.get());
+	if (!index) {
+		index = std::make_shared<const LineIndex>(source.begin, source.end);
+		std::atomic_store(lines.get(), index);	// a concurrent call may build an identical one; either is kept
+	}
+	return index->find(p - source.begin);
 }
 
 void Context::error(const std::string error) {
-	size_t offset = p - processing.source->begin();
-	std::pair<int, int> lineAndColumn = calculateLineAndColumn(*processing.source, offset);
+	size_t offset = p - processing.source.begin;
+	std::pair<int, int> lineAndColumn = processing.lineAndColumn(p);
 	throw Exception(error, *processing.file, offset, lineAndColumn.first, lineAndColumn.second);
 }
 
@@ -312,24 +525,12 @@ void Context::parseArgumentList(std::vector<String>& arguments) {
 	}
 }
 
-static bool standardIncludeLoader(const WideString& fileName, String& contents) {
-    std::ifstream fileStream;
-
-#if defined(_WIN32) || defined(_WIN64)
-    // Windows-specific code
-    fileStream.open(fileName.c_str(), std::ios::in | std::ios::binary);
+static bool standardIncludeLoader(const WideString& fileName, SourceBuffer& contents) {
+#ifdef _WIN32
+	return mapFile(fileName, contents);
 #else
-    // Convert std::wstring to std::string (assuming UTF-8 encoding)
-    std::string narrowFilePath(fileName.begin(), fileName.end());
-    fileStream.open(narrowFilePath.c_str(), std::ios::in | std::ios::binary);
+	return mapFile(String(fileName.begin(), fileName.end()), contents);	// the bytes of the @include directive
 #endif
-
-    if (!fileStream.is_open()) {
-        return false;
-    }
-    fileStream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-    contents.assign(std::istreambuf_iterator<char>(fileStream), std::istreambuf_iterator<char>());
-    return true;
 }
 
 Context::Context(int depthLimiter, Context* parentContext)
@@ -571,7 +772,7 @@ void Context::includeFile() {
 	const String fileName = parseExpression("\n\r");
 	const WideString wideFileName = std::wstring(fileName.begin(), fileName.end());
 	optionalLineBreak();
-	String source;
+	SourceBuffer source;
 	if (!loader(wideFileName, source)) {
 		error(std::string("Could not load include file: ") + fileName);
 	}
@@ -672,7 +873,18 @@ void Context::process(const Span& input, String& output, std::vector<OffsetMapEn
 	}
 }
 
-void Context::setIncludeLoader(const LoaderFunction& loaderFunction) { loader = loaderFunction; }
+void Context::setIncludeLoader(const LoaderFunction& loaderFunction) {
+	loader = [loaderFunction](const WideString& fileName, SourceBuffer& contents) {
+		const std::shared_ptr<String> loaded = std::make_shared<String>();
+		if (!loaderFunction(fileName, *loaded)) {
+			return false;
+		}
+		contents = SourceBuffer(loaded);
+		return true;
+	};
+}
+
+void Context::setIncludeBufferLoader(const BufferLoaderFunction& loaderFunction) { loader = loaderFunction; }
 
 String process(const String& source, const WideString& fileName) {
 	String output;
@@ -1075,6 +1287,20 @@ bool unitTest() {
 			"@begin dupl(qwer,c,def,qwer,asdf) @end"
 			, "Duplicate parameter name \"qwer\"", 27, 1, 28));
 
+	{
+		const String text = "\nab\n\n\tcd\ne";
+		const LineIndex lines(text.data(), text.data() + text.size());
+		for (size_t i = 0; i <= text.size(); ++i) {
+			assert(lines.find(i) == calculateLineAndColumn(text, i));
+		}
+		assert(lines.find(text.find('d')) == std::make_pair(4, 3));
+		const StringIt b = text.data();
+		const Span span(SourceBuffer(b, b + text.size(), 0), L"");
+		const Span part(span, b + 3, b + text.size());		// shares the index that `span` builds
+		assert(span.lineAndColumn(b + text.find('d')) == std::make_pair(4, 3));
+		assert(part.lineAndColumn(b + text.size()) == std::make_pair(5, 2));
+	}
+
 	return true;
 }
 
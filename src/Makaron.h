@@ -17,7 +17,7 @@ typedef char Char;
 typedef wchar_t WideChar;
 typedef std::basic_string<Char> String;
 typedef std::basic_string<WideChar> WideString;
-typedef String::const_iterator StringIt;
+typedef const Char* StringIt;	// into the source, which is not necessarily a String (see SourceBuffer)
 
 class Exception : public std::exception {
 	public:		Exception(const std::string& error, const std::wstring& file, size_t offset, int line, int column)
@@ -38,20 +38,58 @@ class Exception : public std::exception {
 				mutable std::string errorWithLine;
 };
 
+/**
+	A read-only range of source code chars in memory together with a shared pointer that keeps them valid, e.g. a
+	memory-mapped file (see mapFile()) or a String shared with the caller. Spans of a SourceBuffer don't copy it.
+*/
+struct SourceBuffer {
+	SourceBuffer() : begin(0), end(0) { }
+	SourceBuffer(const Char* begin, const Char* end, const std::shared_ptr<const void>& owner)
+			: owner(owner), begin(begin), end(end) { }
+	explicit SourceBuffer(const std::shared_ptr<const String>& string)
+			: owner(string), begin(string->data()), end(string->data() + string->size()) { }
+	std::shared_ptr<const void> owner;
+	const Char* begin;
+	const Char* end;
+};
+
+/**
+	Maps a file read-only (no copy) and returns false if it fails. Pipes, devices and other files that can't be mapped
+	are read into a String instead. A String path is used as is, except on Windows where it is converted from the ANSI
+	code page. A WideString path is opened with CreateFileW() on Windows, elsewhere it is encoded as UTF-8.
+*/
+bool mapFile(const String& fileName, SourceBuffer& buffer);
+bool mapFile(const WideString& fileName, SourceBuffer& buffer);
+
+/**
+	Offsets of all line starts in a source for finding line and column with a binary search instead of by counting
+	line feeds from the beginning. The lines are indexed on construction and never change, so concurrent find() calls
+	are safe. Span::lineAndColumn() builds one on its first call (see Numbstrict::LineIndex).
+*/
+class LineIndex {
+	public:		LineIndex(const StringIt& begin, const StringIt& end);		/// indexes all lines of [begin, end)
+				std::pair<int, int> find(size_t offset) const;		/// line and column for `offset`
+
+	protected:	std::vector<size_t> lineStarts;
+};
+
 class Span {
 	friend class Context;
-	public:		Span(const String& sourceCode, const WideString& fileName);
+	public:		Span(const String& sourceCode, const WideString& fileName);		/// copies `sourceCode`
+				Span(const SourceBuffer& sourceBuffer, const WideString& fileName);		/// refers to `sourceBuffer`
 				Span(const Span& s, const StringIt& b, const StringIt& e) : source(s.source), file(s.file)
-						, begin(b), end(e) {
-					assert(begin >= source->begin() && end <= source->end());
+						, lines(s.lines), begin(b), end(e) {
+					assert(begin >= source.begin && end <= source.end);
 				}
 				operator String() const { return String(begin, end); }
 				operator String() { return String(begin, end); }
-				size_t sourceOffset(const StringIt& p) { return p - source->begin(); }
+				size_t sourceOffset(const StringIt& p) { return p - source.begin; }
+				std::pair<int, int> lineAndColumn(const StringIt& p) const;		/// line and column of `p` in source
 
-	protected:	Span() { }
-				std::shared_ptr<const String> source;
+	protected:	Span() : begin(0), end(0) { }
+				SourceBuffer source;
 				std::shared_ptr<const WideString> file;
+				std::shared_ptr<std::shared_ptr<const LineIndex> > lines;	/// shared by all Spans of the same source
 				StringIt begin;
 				StringIt end;
 };
@@ -83,6 +121,7 @@ class Context {
 				};
 	
 	public:		typedef std::function<bool (const WideString& fileName, String& contents)> LoaderFunction;
+				typedef std::function<bool (const WideString& fileName, SourceBuffer& contents)> BufferLoaderFunction;
 	
 				Context(int depthLimiter = DEFAULT_RECURSION_DEPTH_LIMIT,
 						Context* parentContext = 0);		/// init with depth limit and parent
@@ -93,6 +132,7 @@ class Context {
 				void process(const Span& input, String& output,
 						std::vector<OffsetMapEntry>* offsetMap);		/// expand input; fill offsets if provided
 				void setIncludeLoader(const LoaderFunction& loaderFunction);		/// set loader used by @include
+				void setIncludeBufferLoader(const BufferLoaderFunction& loaderFunction);		/// same without copying
 	
 	protected:	static bool isWhite(const Char c);		/// true if `c` is whitespace
 				static bool isLeadingIdentifierChar(const Char c);		/// true if `c` can start identifier
@@ -123,7 +163,7 @@ class Context {
 
 				Context* const parentContext;
 				int depthLimiter;
-				LoaderFunction loader;
+				BufferLoaderFunction loader;
 				std::map<String, Macro> macros;
 				std::map<String, String> strings;
 				Span processing;
@@ -146,6 +186,7 @@ RangeVector findInputRanges(const std::vector<OffsetMapEntry>& offsetMap,
 				size_t outputOffset);	/// map output offset to input ranges
 
 std::pair<int, int> calculateLineAndColumn(const String& text, size_t offset);	/// get line and column for `offset`
+std::pair<int, int> calculateLineAndColumn(const SourceBuffer& text, size_t offset);	/// same for a SourceBuffer
 String process(const String& source, const WideString& fileName);	/// convenience wrapper using default context
 bool unitTest();	/// run built-in tests
 
@@ -24,10 +24,49 @@
 #include <limits>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <cstdio>
 #include <cstring>
 #include <type_traits>
+#include <thread>
+#include <atomic>
+#include <system_error>
+#include <new>
 #include "Numbstrict.h"
 
+/*
+	SIMD kernels for skipping white, comments and quoted strings are used with SSE2 (always available on x64) and AVX2
+	(when enabled with e.g. -mavx2 or /arch:AVX2). Define NUMBSTRICT_NO_SIMD to use the portable scalar code only.
+*/
+#if !defined(NUMBSTRICT_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+	#define NUMBSTRICT_SSE2 1
+	#include <emmintrin.h>
+	#if defined(__AVX2__)
+		#define NUMBSTRICT_AVX2 1
+		#include <immintrin.h>
+	#endif
+	#ifdef _MSC_VER
+		#include <intrin.h>
+	#endif
+#endif
+
+// For mapFile().
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#ifndef WIN32_LEAN_AND_MEAN
+		#define WIN32_LEAN_AND_MEAN
+	#endif
+	#include <windows.h>
+#else
+	#include <cerrno>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 namespace Numbstrict {
 
 /*
@@ -120,19 +159,297 @@ static int fromHex(Char c) {
 	}
 }
 
+/*
+	Char classes for scanChars(). stops() is the scalar definition. With SIMD, sse2() and avx2() return a bit mask with
+	a bit set for each byte that stops(). Classes with state (e.g. the quote char) are passed as instances.
+*/
+struct NonWhiteChars {
+	static bool stops(Char c) { return !(c == ' ' || c == '\t' || c == '\r' || c == '\n'); }
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i white = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\t'))), _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\n'))));
+		return ~static_cast<uint32_t>(_mm_movemask_epi8(white)) & 0xFFFFU;
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i white = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))
+				, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))), _mm256_or_si256(_mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+		return ~static_cast<uint32_t>(_mm256_movemask_epi8(white));
+	}
+#endif
+};
+
+struct NonHorizontalWhiteChars {
+	static bool stops(Char c) { return !(c == ' ' || c == '\t'); }
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i white = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\t')));
+		return ~static_cast<uint32_t>(_mm_movemask_epi8(white)) & 0xFFFFU;
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i white = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('\t')));
+		return ~static_cast<uint32_t>(_mm256_movemask_epi8(white));
+	}
+#endif
+};
+
+// Line comments end at line breaks and at invalid control chars (everything below 32 except tab).
+struct LineCommentEndChars {
+	static bool stops(Char c) { return (static_cast<UChar>(c) < 32 && c != '\t'); }
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(31)), v);
+		const __m128i tab = _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_andnot_si128(tab, control)));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(31)), v);
+		const __m256i tab = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_andnot_si256(tab, control)));
+	}
+#endif
+};
+
+// Block comments need attention at '/' and '*' (possible nesting or end) and at invalid control chars.
+struct BlockCommentSpecialChars {
+	static bool stops(Char c) {
+		return (c == '/' || c == '*' || (static_cast<UChar>(c) < 32 && c != '\r' && c != '\n' && c != '\t'));
+	}
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(31)), v);
+		const __m128i white = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\t')), _mm_or_si128(_mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\r')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+		const __m128i special = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('/')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('*')));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(special, _mm_andnot_si128(white, control))));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(31)), v);
+		const __m256i white = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))
+				, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), _mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('\n'))));
+		const __m256i special = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')), _mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('*')));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(special
+				, _mm256_andnot_si256(white, control))));
+	}
+#endif
+};
+
+// Quoted strings need attention at the end quote and at escapes.
+struct QuoteOrEscapeChars {
+	QuoteOrEscapeChars(Char quoteChar) : quoteChar(quoteChar) { }
+	bool stops(Char c) const { return (c == quoteChar || c == '\\'); }
+#ifdef NUMBSTRICT_SSE2
+	uint32_t sse2(__m128i v) const {
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quoteChar))
+				, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')))));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	uint32_t avx2(__m256i v) const {
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8(quoteChar)), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')))));
+	}
+#endif
+	const Char quoteChar;
+};
+
+// When unquoting, also at chars that are invalid in quoted strings (control chars and 127).
+struct QuotedStringSpecialChars {
+	QuotedStringSpecialChars(Char quoteChar) : quoteChar(quoteChar) { }
+	bool stops(Char c) const {
+		return (c == quoteChar || c == '\\' || static_cast<UChar>(c) < 32 || static_cast<UChar>(c) == 127);
+	}
+#ifdef NUMBSTRICT_SSE2
+	uint32_t sse2(__m128i v) const {
+		const __m128i control = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(31)), v);
+		const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(quoteChar)), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\\'))), _mm_cmpeq_epi8(v, _mm_set1_epi8(127)));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(special, control)));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	uint32_t avx2(__m256i v) const {
+		const __m256i control = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(31)), v);
+		const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(quoteChar))
+				, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(127)));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(special, control)));
+	}
+#endif
+	const Char quoteChar;
+};
+
+// Chars that the structural index records (or that begin strings and comments) when outside strings and comments.
+struct StructuralChars {
+	static bool stops(Char c) {
+		switch (c) {
+			case '{': case '}': case ':': case ',': case '\n': case '\"': case '\'': case '/': return true;
+			default: return false;
+		}
+	}
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i braces = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('}')));
+		const __m128i separators = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8(','))), _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+		const __m128i openers = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\''))), _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(braces, separators), openers)));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i braces = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('}')));
+		const __m256i separators = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))
+				, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+		const __m256i openers = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"'))
+				, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(braces, separators)
+				, openers)));
+	}
+#endif
+};
+
+// Chars that matter inside nested blocks when splitting top-level lists (see ParallelChunkParser::split()).
+struct BlockChars {
+	static bool stops(Char c) { return (c == '{' || c == '}' || c == '\"' || c == '\'' || c == '/'); }
+#ifdef NUMBSTRICT_SSE2
+	static uint32_t sse2(__m128i v) {
+		const __m128i braces = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('{')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('}')));
+		const __m128i openers = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\"')), _mm_cmpeq_epi8(v
+				, _mm_set1_epi8('\''))), _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+		return static_cast<uint32_t>(_mm_movemask_epi8(_mm_or_si128(braces, openers)));
+	}
+#endif
+#ifdef NUMBSTRICT_AVX2
+	static uint32_t avx2(__m256i v) {
+		const __m256i braces = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(v
+				, _mm256_set1_epi8('}')));
+		const __m256i openers = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\"'))
+				, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+		return static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_or_si256(braces, openers)));
+	}
+#endif
+};
+
+#ifdef NUMBSTRICT_SSE2
+static int lowestSetBit(uint32_t mask) {
+	assert(mask != 0);
+#ifdef _MSC_VER
+	unsigned long i;
+	_BitScanForward(&i, mask);
+	return static_cast<int>(i);
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+/*
+	Returns the first char in [p, e) that stops() according to char class `C`, or `e`. Runs are often short (e.g. a
+	single space), so the first char is checked before going wide.
+*/
+template<class C> const Char* scanChars(const Char* p, const Char* const e, const C& chars = C()) {
+	if (p == e || chars.stops(*p)) {
+		return p;
+	}
+	++p;
+#ifdef NUMBSTRICT_AVX2
+	while (e - p >= 32) {
+		const uint32_t mask = chars.avx2(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+		if (mask != 0) {
+			return p + lowestSetBit(mask);
+		}
+		p += 32;
+	}
+#endif
+#ifdef NUMBSTRICT_SSE2
+	while (e - p >= 16) {
+		const uint32_t mask = chars.sse2(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+		if (mask != 0) {
+			return p + lowestSetBit(mask);
+		}
+		p += 16;
+	}
+#endif
+	while (p != e && !chars.stops(*p)) {
+		++p;
+	}
+	return p;
+}
+
+/*
+	Appends (ISO-8859-1) chars to a string of any char type. (`insert` and `append` with iterators construct a temporary
+	string in some standard libraries, which is one heap allocation per call.)
+*/
+template<typename C> void appendChars(std::basic_string<C>& string, StringIt b, StringIt e) {
+	const size_t n = string.size();
+	string.resize(n + (e - b));
+	for (typename std::basic_string<C>::iterator it = string.begin() + n; b != e; ++b, ++it) {
+		*it = static_cast<UChar>(*b);
+	}
+}
+
+static void appendChars(String& string, StringIt b, StringIt e) {
+	if (b != e) {
+		string.append(&*b, e - b);
+	}
+}
+
+static StringView viewOf(const StringIt b, const StringIt e) {
+	return (b == e ? StringView() : StringView(b, e));
+}
+
+int StringView::compare(const StringView& other) const {
+	const size_t n = size();
+	const size_t m = other.size();
+	const int c = (std::min(n, m) == 0 ? 0 : std::char_traits<Char>::compare(b, other.b, std::min(n, m)));
+	return (c != 0 ? c : (n < m ? -1 : (n > m ? 1 : 0)));
+}
+
+// Returns the end quote (or `e` if unterminated) of a quoted string starting (after the begin quote) at `p`.
+template<typename I> I findEndQuote(I p, const I e, const QuoteOrEscapeChars& quoteOrEscape) {
+	while ((p = scanChars(p, e, quoteOrEscape)) != e && *p != quoteOrEscape.quoteChar) {
+		++p;
+		if (p != e) {
+			++p;
+		}
+	}
+	return p;
+}
+
 template<typename C> bool genericUnquoteString(StringIt& p, const StringIt e, std::basic_string<C>& string) {
 	const Char quoteChar = *p;
 	assert(quoteChar == '\"' || quoteChar == '\'');
 	++p;
+	const QuotedStringSpecialChars specialChars(quoteChar);
 	StringIt b = p;
-	while (p != e && *p != quoteChar) {
-		if (*p < 0) {	// assume iso8859-1
-			string.insert(string.end(), b, p);
-			string.push_back(static_cast<unsigned char>(*p));
-			++p;
-			b = p;
-		} else if (*p == '\\') {
-			string.insert(string.end(), b, p);
+	p = scanChars(p, e, specialChars);
+	if (p != e && *p == '\\') {
+		// Unescaping never makes a string longer, so the rest of the input bounds the output. Presize up to a guess from
+		// the run before the first escape, and let longer strings grow (finding the end quote first scans them twice).
+		string.reserve(string.size() + std::min<size_t>(e - b, 2 * (p - b) + 64));
+	}
+	for (; p != e && *p != quoteChar; p = scanChars(p, e, specialChars)) {
+		if (*p == '\\') {
+			appendChars(string, b, p);
 			++p;
 			if (p == e) {
 				return false;
@@ -208,13 +525,11 @@ template<typename C> bool genericUnquoteString(StringIt& p, const StringIt e, st
 				default: return false;
 			}
 			b = p;
-		} else if (static_cast<UChar>(*p) < 32 || static_cast<UChar>(*p) >= 127) {
-			return false;
 		} else {
-			++p;
+			return false;
 		}
 	}
-	string.insert(string.end(), b, p);
+	appendChars(string, b, p);
 	if (p == e) {
 		return false;
 	}
@@ -222,9 +537,43 @@ template<typename C> bool genericUnquoteString(StringIt& p, const StringIt e, st
 	return true;
 }
 
+// Writes the decimal digits of `i` backwards, two at a time, so that they end at `end`. Returns the first char.
+template<class T> Char* decimalToString(Char* end, T i) {
+	static const char DIGIT_PAIRS[] =
+			"00010203040506070809101112131415161718192021222324"
+			"25262728293031323334353637383940414243444546474849"
+			"50515253545556575859606162636465666768697071727374"
+			"75767778798081828384858687888990919293949596979899";
+	typedef typename std::make_unsigned<T>::type UT;
+	const bool negative = (std::numeric_limits<T>::is_signed && i < 0);
+	UT x = (negative ? static_cast<UT>(0 - static_cast<UT>(i)) : static_cast<UT>(i));
+	Char* p = end;
+	while (x >= 100) {
+		const unsigned int pair = static_cast<unsigned int>(x % 100) * 2;
+		x /= 100;
+		p -= 2;
+		p[0] = DIGIT_PAIRS[pair];
+		p[1] = DIGIT_PAIRS[pair + 1];
+	}
+	if (x >= 10) {
+		p -= 2;
+		p[0] = DIGIT_PAIRS[x * 2];
+		p[1] = DIGIT_PAIRS[x * 2 + 1];
+	} else {
+		*--p = static_cast<Char>('0' + x);
+	}
+	if (negative) {
+		*--p = '-';
+	}
+	return p;
+}
+
 template<class T> Char* intToString(Char* buffer, T i, int radix = 10, int minLength = 1) {
 	assert(2 <= radix && radix <= 16);
 	assert(0 <= minLength && minLength <= static_cast<int>(sizeof (T) * 8));
+	if (radix == 10 && minLength == 1) {
+		return decimalToString(buffer + sizeof (T) * 8 + 1, i);
+	}
 	Char* p = buffer + sizeof (T) * 8 + 1;
 	Char* e = p - minLength;
 	for (T x = i; p > e || x != 0; x /= radix) {
@@ -385,14 +734,25 @@ static double multiplyAndAdd(double term, double factorA, double factorB) {
 
 template<typename T> struct Traits { };
 
+/*
+	SIGNIFICAND_BITS etc describe the IEEE 754 layout for exactRealToString() and exactDecimalToReal().
+	FAST_MIN_EXPONENT is the lowest decimal exponent they handle, MARGIN_LOG2 and PARSE_MARGIN_LOG2 are their safety
+	margins (see each).
+*/
 template<> struct Traits<double> {
 	enum { MIN_EXPONENT = -324, MAX_EXPONENT = 308 };
 	typedef DoubleDouble Hires;
+	typedef uint64_t Bits;
+	enum { SIGNIFICAND_BITS = 52, EXPONENT_BIAS = 1075, MAX_DIGITS = 17, FAST_MIN_EXPONENT = -300, MARGIN_LOG2 = -24
+			, PARSE_MARGIN_LOG2 = -80 };
 };
 
 template<> struct Traits<float> {
 	enum { MIN_EXPONENT = -45, MAX_EXPONENT = 38 };
 	typedef double Hires;
+	typedef uint32_t Bits;
+	enum { SIGNIFICAND_BITS = 23, EXPONENT_BIAS = 150, MAX_DIGITS = 9, FAST_MIN_EXPONENT = -45, MARGIN_LOG2 = 14
+			, PARSE_MARGIN_LOG2 = -40 };
 };
 
 /*
@@ -431,14 +791,35 @@ struct Exp10Table {
 			normals[i - Traits<double>::MIN_EXPONENT] = normal;
 			factors[i - Traits<double>::MIN_EXPONENT] = factor;
 		}
+
+		for (int i = Traits<double>::MIN_EXPONENT; i <= Traits<double>::MAX_EXPONENT; ++i) {
+			doubles[i - Traits<double>::MIN_EXPONENT] = static_cast<double>(normals[i - Traits<double>::MIN_EXPONENT])
+					* factors[i - Traits<double>::MIN_EXPONENT];
+		}
+		for (int i = Traits<float>::MIN_EXPONENT; i <= Traits<float>::MAX_EXPONENT; ++i) {
+			floats[i - Traits<float>::MIN_EXPONENT] = static_cast<float>(doubles[i - Traits<double>::MIN_EXPONENT]);
+		}
 	}
 	DoubleDouble normals[Traits<double>::MAX_EXPONENT + 1 - Traits<double>::MIN_EXPONENT];
 	double factors[Traits<double>::MAX_EXPONENT + 1 - Traits<double>::MIN_EXPONENT];
+	double doubles[Traits<double>::MAX_EXPONENT + 1 - Traits<double>::MIN_EXPONENT];	// normals * factors
+	float floats[Traits<float>::MAX_EXPONENT + 1 - Traits<float>::MIN_EXPONENT];
+	double value(int exponent, double) const { return doubles[exponent - Traits<double>::MIN_EXPONENT]; }
+	float value(int exponent, float) const { return floats[exponent - Traits<float>::MIN_EXPONENT]; }
 } EXP10_TABLE;
 
+/*
+	Sets up the standard floating-point environment for a conversion and restores the previous one at the end of scope.
+	Does nothing inside a RealConversionScope (batchDepth > 0), which has already set it up for the thread.
+*/
 class StandardFPEnvScope {
 	public:
-		StandardFPEnvScope() {
+		static thread_local int batchDepth;
+
+		StandardFPEnvScope() : switched(batchDepth == 0) {
+			if (!switched) {
+				return;
+			}
 		// use _control87 and __control87_2 in MSVC instead for greater control (fesetenv doesn't change flush-denormals-to-zero mode)
 		#ifdef _MSC_VER
 			const unsigned int COMMON_BITS = _EM_INEXACT | _EM_UNDERFLOW | _EM_OVERFLOW | _EM_ZERODIVIDE | _EM_INVALID | _EM_DENORMAL | _RC_NEAR;
@@ -470,6 +851,9 @@ class StandardFPEnvScope {
 		}
 	
 		~StandardFPEnvScope() {
+			if (!switched) {
+				return;
+			}
 		#ifdef _MSC_VER
 		#ifdef _M_IX86
 			unsigned int dummyX86;
@@ -490,6 +874,7 @@ class StandardFPEnvScope {
 		}
 	
 	protected:
+		const bool switched;
 	#ifdef _MSC_VER
 	#ifdef _M_IX86
 		unsigned int previousX86;
@@ -500,9 +885,271 @@ class StandardFPEnvScope {
 	#endif
 };
 
-template<typename T> const Char* parseReal(const Char* const b, const Char* const e, T& value) {
+thread_local int StandardFPEnvScope::batchDepth = 0;
+
+RealConversionScope::RealConversionScope() : outermost(StandardFPEnvScope::batchDepth == 0) {
+	static_assert(sizeof (StandardFPEnvScope) <= sizeof (environment), "RealConversionScope::environment is too small");
+	if (outermost) {
+		new (&environment) StandardFPEnvScope();
+	}
+	++StandardFPEnvScope::batchDepth;
+}
+
+RealConversionScope::~RealConversionScope() {
+	--StandardFPEnvScope::batchDepth;
+	if (outermost) {
+		reinterpret_cast<StandardFPEnvScope*>(&environment)->~StandardFPEnvScope();
+	}
+}
+
+/*
+	64.64 bit unsigned fixed point number and 128-bit powers of 10 for exactDecimalToReal() and exactRealToString().
+	Pow10Table holds 10^k ~= significands[k] * 2^exponents[k] with the significand normalized to 128 bits. Entries are
+	derived from each other by truncating multiplications or divisions by 10, so the relative error stays below 2^-118.
+*/
+struct Fixed64 {
+	Fixed64() { }
+	Fixed64(uint64_t integer, uint64_t fraction) : integer(integer), fraction(fraction) { }
+	Fixed64 operator-(const Fixed64& other) const {
+		return Fixed64(integer - other.integer - (fraction < other.fraction ? 1 : 0), fraction - other.fraction);
+	}
+	bool operator<(const Fixed64& other) const {
+		return integer < other.integer || (integer == other.integer && fraction < other.fraction);
+	}
+	uint64_t integer;
+	uint64_t fraction;
+};
+
+static void multiply64(uint64_t a, uint64_t b, uint64_t& high, uint64_t& low) {
+#if defined(__SIZEOF_INT128__)
+	const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+	high = static_cast<uint64_t>(product >> 64);
+	low = static_cast<uint64_t>(product);
+#elif defined(_MSC_VER) && defined(_M_X64)
+	low = _umul128(a, b, &high);
+#else
+	const uint64_t aLow = a & 0xFFFFFFFFU;
+	const uint64_t aHigh = a >> 32;
+	const uint64_t bLow = b & 0xFFFFFFFFU;
+	const uint64_t bHigh = b >> 32;
+	const uint64_t lowLow = aLow * bLow;
+	const uint64_t highLow = aHigh * bLow;
+	const uint64_t lowHigh = aLow * bHigh;
+	const uint64_t middle = (lowLow >> 32) + (highLow & 0xFFFFFFFFU) + (lowHigh & 0xFFFFFFFFU);
+	high = aHigh * bHigh + (highLow >> 32) + (lowHigh >> 32) + (middle >> 32);
+	low = (middle << 32) | (lowLow & 0xFFFFFFFFU);
+#endif
+}
+
+struct Pow10Table {
+	enum { MIN_POWER = 16 - Traits<double>::MAX_EXPONENT, MAX_POWER = 16 - Traits<double>::FAST_MIN_EXPONENT };
+	Pow10Table() {
+		uint32_t limbs[5] = { 0, 0, 0, 0x80000000U, 0 };	// least significant first
+		int exponent = -127;
+		for (int k = 0; k <= MAX_POWER; ++k) {
+			store(k, limbs, exponent);
+			uint64_t carry = 0;
+			for (int i = 0; i < 4; ++i) {
+				const uint64_t product = static_cast<uint64_t>(limbs[i]) * 10 + carry;
+				limbs[i] = static_cast<uint32_t>(product);
+				carry = product >> 32;
+			}
+			limbs[4] = static_cast<uint32_t>(carry);
+			normalize(limbs, exponent);
+		}
+		limbs[0] = limbs[1] = limbs[2] = 0;
+		limbs[3] = 0x80000000U;
+		exponent = -127;
+		for (int k = -1; k >= MIN_POWER; --k) {
+			limbs[4] = limbs[3] >> 28;					// times 16 ...
+			for (int i = 3; i > 0; --i) {
+				limbs[i] = (limbs[i] << 4) | (limbs[i - 1] >> 28);
+			}
+			limbs[0] <<= 4;
+			exponent -= 4;
+			uint64_t remainder = 0;						// ... divided by 10
+			for (int i = 4; i >= 0; --i) {
+				const uint64_t dividend = (remainder << 32) | limbs[i];
+				limbs[i] = static_cast<uint32_t>(dividend / 10);
+				remainder = dividend % 10;
+			}
+			normalize(limbs, exponent);
+			store(k, limbs, exponent);
+		}
+	}
+	static void normalize(uint32_t limbs[5], int& exponent) {
+		while (limbs[4] != 0) {
+			for (int i = 0; i < 4; ++i) {
+				limbs[i] = (limbs[i] >> 1) | (limbs[i + 1] << 31);
+			}
+			limbs[4] >>= 1;
+			++exponent;
+		}
+	}
+	void store(int k, const uint32_t limbs[5], int exponent) {
+		highs[k - MIN_POWER] = (static_cast<uint64_t>(limbs[3]) << 32) | limbs[2];
+		lows[k - MIN_POWER] = (static_cast<uint64_t>(limbs[1]) << 32) | limbs[0];
+		exponents[k - MIN_POWER] = exponent;
+	}
+
+	// significand * 10^k ~= words * 2^(return value), with words[2] the most significant. -MIN_POWER <= k <= MAX_POWER.
+	int product(uint64_t significand, int k, uint64_t words[3]) const {
+		assert(MIN_POWER <= k && k <= MAX_POWER);
+		uint64_t lowHigh;
+		uint64_t highLow;
+		multiply64(significand, lows[k - MIN_POWER], lowHigh, words[0]);
+		multiply64(significand, highs[k - MIN_POWER], words[2], highLow);
+		words[1] = lowHigh + highLow;
+		words[2] += (words[1] < highLow ? 1 : 0);
+		return exponents[k - MIN_POWER];
+	}
+
+	/*
+		Returns significand * 2^binaryExponent * 10^k as 64.64 fixed point, or false if it doesn't fit (or 10^k is out
+		of range). The result is truncated, i.e. 2^-64 lower than the exact product at most (plus the error of the
+		table).
+	*/
+	bool multiply(uint64_t significand, int binaryExponent, int k, Fixed64& result) const {
+		if (k < MIN_POWER || k > MAX_POWER) {
+			return false;
+		}
+		uint64_t words[3];
+		const int shift = -(binaryExponent + product(significand, k, words) + 64);	// right shift of the product
+		if (shift <= 0 || shift >= 128) {
+			return false;
+		}
+		const int wordShift = shift / 64;
+		const int bitShift = shift % 64;
+		uint64_t shifted[3];
+		for (int i = 0; i < 3; ++i) {
+			const uint64_t low = (i + wordShift < 3 ? words[i + wordShift] : 0);
+			const uint64_t high = (i + wordShift + 1 < 3 ? words[i + wordShift + 1] : 0);
+			shifted[i] = (bitShift == 0 ? low : (low >> bitShift) | (high << (64 - bitShift)));
+		}
+		if (shifted[2] != 0) {
+			return false;
+		}
+		result = Fixed64(shifted[1], shifted[0]);
+		return true;
+	}
+
+	uint64_t highs[MAX_POWER + 1 - MIN_POWER];
+	uint64_t lows[MAX_POWER + 1 - MIN_POWER];
+	int exponents[MAX_POWER + 1 - MIN_POWER];
+} POW10_TABLE;
+
+static void subtract192(const uint64_t a[3], const uint64_t b[3], uint64_t difference[3]) {
+	uint64_t borrow = 0;
+	for (int i = 0; i < 3; ++i) {
+		const uint64_t d = a[i] - b[i];
+		difference[i] = d - borrow;
+		borrow = (a[i] < b[i] || d < borrow ? 1 : 0);
+	}
+}
+
+static int countLeadingZeros(uint64_t x) {
+	assert(x != 0);
+	int count = 0;
+	for (int shift = 32; shift > 0; shift >>= 1) {
+		if ((x >> (64 - shift)) == 0) {
+			count += shift;
+			x <<= shift;
+		}
+	}
+	return count;
+}
+
+/*
+	Eisel-Lemire style conversion of up to 19 significant digits [p, significandEnd) (which may include the period, the
+	first digit being non-zero and having the decimal `exponent`). The digits as a 64-bit integer are multiplied with
+	a 128-bit 10^k and the top bits rounded to nearest. Returns false (and leaves the decision to the digit loop in
+	parseReal()) for too many digits, results that aren't normal and products within a safety margin of half an ulp,
+	where the digit loop's double-double arithmetic could round either way. Does not depend on the floating point
+	environment.
+*/
+template<typename T> static bool exactDecimalToReal(const Char* p, const Char* significandEnd, int exponent
+		, T& value) {
+	typedef typename Traits<T>::Bits Bits;
+	enum {
+		MANTISSA_BITS = Traits<T>::SIGNIFICAND_BITS + 1
+		, REST_BITS = 64 - MANTISSA_BITS				// bits of words[2] below the mantissa
+		, MARGIN_BIT = 191 + Traits<T>::PARSE_MARGIN_LOG2	// of the normalized 192-bit product, at least 64
+	};
+	if (exponent < Traits<T>::FAST_MIN_EXPONENT || exponent > Traits<T>::MAX_EXPONENT) {
+		return false;
+	}
+	uint64_t digits = 0;
+	int count = 0;
+	for (; p != significandEnd; ++p) {
+		if (*p != '.') {
+			if (++count > 19) {
+				return false;
+			}
+			digits = digits * 10 + (*p - '0');
+		}
+	}
+	const int k = exponent - (count - 1);
+	if (k < Pow10Table::MIN_POWER || k > Pow10Table::MAX_POWER) {
+		return false;
+	}
+	const int leadingZeros = countLeadingZeros(digits);
+	uint64_t words[3];
+	int binaryExponent = POW10_TABLE.product(digits << leadingZeros, k, words) - leadingZeros;
+	if ((words[2] >> 63) == 0) {
+		words[2] = (words[2] << 1) | (words[1] >> 63);
+		words[1] = (words[1] << 1) | (words[0] >> 63);
+		words[0] <<= 1;
+		--binaryExponent;
+	}
+
+	// Distance between the bits below the mantissa and half an ulp.
+	const uint64_t rest[3] = { words[0], words[1], words[2] & ((static_cast<uint64_t>(1) << REST_BITS) - 1) };
+	const uint64_t half[3] = { 0, 0, static_cast<uint64_t>(1) << (REST_BITS - 1) };
+	const bool above = (rest[2] != half[2] ? rest[2] > half[2] : (rest[1] | rest[0]) != 0);
+	uint64_t distance[3];
+	subtract192(above ? rest : half, above ? half : rest, distance);
+	const uint64_t margin = static_cast<uint64_t>(1) << (MARGIN_BIT % 64);
+	if ((MARGIN_BIT >= 128 ? distance[2] < margin : distance[2] == 0 && distance[1] < margin)) {
+		return false;
+	}
+
+	uint64_t mantissa = (words[2] >> REST_BITS) + (above ? 1 : 0);
+	binaryExponent += 128 + REST_BITS;
+	if ((mantissa >> MANTISSA_BITS) != 0) {
+		mantissa >>= 1;
+		++binaryExponent;
+	}
+	const int biasedExponent = binaryExponent + Traits<T>::EXPONENT_BIAS;
+	const int EXPONENT_MASK = (1 << (sizeof (Bits) * 8 - 1 - Traits<T>::SIGNIFICAND_BITS)) - 1;
+	if (biasedExponent <= 0 || biasedExponent >= EXPONENT_MASK) {
+		return false;
+	}
+	const Bits bits = (static_cast<Bits>(biasedExponent) << Traits<T>::SIGNIFICAND_BITS)
+			| (static_cast<Bits>(mantissa) & ((static_cast<Bits>(1) << Traits<T>::SIGNIFICAND_BITS) - 1));
+	memcpy(&value, &bits, sizeof (value));
+	return true;
+}
+
+// The general conversion for parseReal(): accumulates all digits [p, significandEnd) in double-double precision.
+template<typename T> static T digitLoopDecimalToReal(const Char* p, const Char* significandEnd, int exponent, T sign) {
 	StandardFPEnvScope standardFPEnv;
-	
+	assert(Traits<double>::MIN_EXPONENT <= exponent && exponent <= Traits<double>::MAX_EXPONENT);
+	typename Traits<T>::Hires magnitude = EXP10_TABLE.normals[exponent - Traits<double>::MIN_EXPONENT];
+	typename Traits<T>::Hires accumulator(0.0);
+	while (p != significandEnd) {
+		if (*p != '.') {
+			accumulator = multiplyAndAdd(accumulator, magnitude, (*p - '0'));
+			magnitude = magnitude / 10;
+		}
+		++p;
+	}
+	const double factor = EXP10_TABLE.factors[exponent - Traits<double>::MIN_EXPONENT];
+	T value = static_cast<T>(static_cast<double>(accumulator) * factor);
+	value *= sign;
+	return value;
+}
+
+template<typename T> const Char* parseReal(const Char* const b, const Char* const e, T& value) {
 	int exponent = -1;
 	T sign = (T)(1.0);
 	const Char* significandBegin = b;
@@ -569,58 +1216,222 @@ template<typename T> const Char* parseReal(const Char* const b, const Char* cons
 			value = (T)(0.0);
 		} else if (exponent > Traits<T>::MAX_EXPONENT) {
 			value = std::numeric_limits<T>::infinity();
+		} else if (exactDecimalToReal(p, significandEnd, exponent, value)) {
+			value = (sign < 0 ? -value : value);
+			return numberEnd;
 		} else {
-			assert(Traits<double>::MIN_EXPONENT <= exponent && exponent <= Traits<double>::MAX_EXPONENT);
-			typename Traits<T>::Hires magnitude = EXP10_TABLE.normals[exponent - Traits<double>::MIN_EXPONENT];
-			typename Traits<T>::Hires accumulator(0.0);
-			while (p != significandEnd) {
-				if (*p != '.') {
-					accumulator = multiplyAndAdd(accumulator, magnitude, (*p - '0'));
-					magnitude = magnitude / 10;
-				}
-				++p;
-			}
-			const double factor = EXP10_TABLE.factors[exponent - Traits<double>::MIN_EXPONENT];
-			value = static_cast<T>(static_cast<double>(accumulator) * factor);
+			value = digitLoopDecimalToReal(p, significandEnd, exponent, sign);
+			return numberEnd;
 		}
 	}
-	value *= sign;
+	value *= sign;	// zero, inf and nan only, which the environment doesn't affect
 	return numberEnd;
 }
 
-template<typename T> Char* realToString(Char buffer[32], const T value) {
-	StandardFPEnvScope standardFPEnv;
-	
-	Char* p = buffer;
+static const uint64_t POW10_64[18] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL
+	, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL
+	, 10000000000000000ULL, 100000000000000000ULL
+};
 
-	T absValue = value;
-	if (value < 0) {
-		*p++ = '-';
-		absValue = -value;
+// floor(log10(2^k)) for -1650 <= k <= 1650 (78913 / 2^18 approximates log10(2) closely enough).
+static int floorLog10Pow2(int k) {
+	return (k >= 0 ? (k * 78913) >> 18 : -((-k * 78913 + (1 << 18) - 1) >> 18));
+}
+
+// 1 if `candidate` is inside the rounding interval (low, high), 0 if outside, -1 if within `margin` of its limits.
+static int classifyCandidate(uint64_t candidate, const Fixed64& low, const Fixed64& high, const Fixed64& margin) {
+	const Fixed64 c(candidate, 0);
+	if (c < low) {
+		return (low - c < margin ? -1 : 0);
+	} else if (high < c) {
+		return (c - high < margin ? -1 : 0);
 	}
-	
-	if (isNaN(absValue)) {
-		strcpy(p, "nan");
-		return p + 3;
-	} else if (absValue == 0.0) {
-		strcpy(p, "0.0");
-		return p + 3;
-	} else if (absValue >= std::numeric_limits<T>::infinity()) {
-		strcpy(p, "inf");
-		return p + 3;
+	return (c - low < margin || high - c < margin ? -1 : 1);
+}
+
+static Char* writeExponent(Char* p, int exponent) {
+	*p++ = 'e';
+	*p++ = (exponent < 0 ? '-' : '+');
+	int x = (exponent < 0 ? -exponent : exponent);
+	Char digits[8];
+	Char* q = digits + 8;
+	do {
+		*--q = "0123456789"[x % 10];
+	} while ((x /= 10) != 0);
+	return std::copy(q, digits + 8, p);
+}
+
+/*
+	Same output as digitLoopRealToString() but with exact integer arithmetic: the value and the limits of its rounding
+	interval are scaled by 10^(16 - exponent) into 64.64 fixed point, and for each digit count the truncated and the
+	incremented candidates are checked against the interval directly. Whenever a decision is too close to call for the
+	digit loop's own double-double precision (ties, candidates at the interval limits etc), this returns 0 and the
+	digit loop decides. Does not depend on the floating point environment: it reads the sign, exponent and significand
+	from the bits and does no floating point arithmetic or comparisons.
+*/
+template<typename T> static Char* exactRealToString(Char buffer[32], const T value) {
+	typedef typename Traits<T>::Bits Bits;
+	Bits bits;
+	memcpy(&bits, &value, sizeof (bits));
+	const int EXPONENT_MASK = (1 << (sizeof (Bits) * 8 - 1 - Traits<T>::SIGNIFICAND_BITS)) - 1;
+	const Bits SIGNIFICAND_MASK = (static_cast<Bits>(1) << Traits<T>::SIGNIFICAND_BITS) - 1;
+	const Bits SIGN = static_cast<Bits>(1) << (sizeof (Bits) * 8 - 1);
+	const int biasedExponent = static_cast<int>(bits >> Traits<T>::SIGNIFICAND_BITS) & EXPONENT_MASK;
+	uint64_t significand = bits & SIGNIFICAND_MASK;
+	if (biasedExponent == EXPONENT_MASK || (biasedExponent == EXPONENT_MASK - 1 && significand == SIGNIFICAND_MASK)) {
+		return 0;	// inf, nan or +-max
+	}
+	if (biasedExponent == 0 && significand == 0) {
+		strcpy(buffer, "0.0");
+		return buffer + 3;
+	}
+	int binaryExponent = 1 - Traits<T>::EXPONENT_BIAS;
+	int topBit = Traits<T>::SIGNIFICAND_BITS;
+	if (biasedExponent != 0) {
+		significand |= static_cast<uint64_t>(1) << Traits<T>::SIGNIFICAND_BITS;
+		binaryExponent = biasedExponent - Traits<T>::EXPONENT_BIAS;
+	} else {
+		while ((significand >> topBit) == 0) {
+			--topBit;
+		}
 	}
 
-	// frexp is fast and precise and gives log2(x), log10(x) = log2(x) / log2(10)
-	int base2Exponent;
-	(void) frexp(absValue, &base2Exponent);
-	int exponent = std::max(static_cast<int>(ceil(0.30102999566398119521 * (base2Exponent - 1))) - 1
+	// Decimal exponent exactly as digitLoopRealToString() finds it.
+	const int base2Exponent = topBit + binaryExponent;
+	int exponent = std::max((base2Exponent == 0 ? -1 : floorLog10Pow2(base2Exponent))
 			, static_cast<int>(Traits<T>::MIN_EXPONENT));
 	if (exponent < Traits<T>::MAX_EXPONENT) {
-		assert(Traits<double>::MIN_EXPONENT <= exponent + 1 && exponent + 1 <= Traits<double>::MAX_EXPONENT);
-		const double factor = EXP10_TABLE.factors[exponent + 1 - Traits<double>::MIN_EXPONENT];
-		const double magnitude = static_cast<double>(EXP10_TABLE.normals[exponent + 1 - Traits<double>::MIN_EXPONENT]);
-
-		// Notice that in theory we could have a value that is considered equal to next magnitude but should be rounded
+		// Compares the bit patterns, which order like the magnitudes, as DAZ would make a subnormal power of 10 zero.
+		const T power = EXP10_TABLE.value(exponent + 1, T());
+		Bits powerBits;
+		memcpy(&powerBits, &power, sizeof (powerBits));
+		if ((bits & ~SIGN) >= powerBits) {
+			++exponent;
+		}
+	}
+	if (exponent < Traits<T>::FAST_MIN_EXPONENT) {
+		return 0;
+	}
+
+	// Value and interval limits in units of 10^(exponent - 16), i.e. 17 digits before the point.
+	const bool closerBelow = (significand == (static_cast<uint64_t>(1) << Traits<T>::SIGNIFICAND_BITS)
+			&& biasedExponent > 1);
+	Fixed64 x;
+	Fixed64 low;
+	Fixed64 high;
+	if (!POW10_TABLE.multiply(significand * 4, binaryExponent - 2, 16 - exponent, x)
+			|| !POW10_TABLE.multiply(significand * 4 - (closerBelow ? 1 : 2), binaryExponent - 2, 16 - exponent, low)
+			|| !POW10_TABLE.multiply(significand * 4 + 2, binaryExponent - 2, 16 - exponent, high)) {
+		return 0;
+	}
+	const Fixed64 margin = (Traits<T>::MARGIN_LOG2 >= 0 ? Fixed64(1ULL << (Traits<T>::MARGIN_LOG2 & 63), 0)
+			: Fixed64(0, 1ULL << ((64 + Traits<T>::MARGIN_LOG2) & 63)));
+
+	for (int count = 1; count <= Traits<T>::MAX_DIGITS; ++count) {
+		const uint64_t unit = POW10_64[17 - count];
+		uint64_t digits = x.integer / unit;
+		const Fixed64 remainder(x.integer % unit, x.fraction);
+		bool done = false;
+		if (remainder < margin || Fixed64(unit, 0) - remainder < margin) {
+			// The digit loop may land on either side of a multiple of unit, but then always picks the multiple.
+			if (!(remainder < margin)) {
+				++digits;
+			}
+			if (classifyCandidate(digits * unit, low, high, margin) != 1) {
+				return 0;
+			}
+			done = true;
+		} else {
+			const int truncated = classifyCandidate(digits * unit, low, high, margin);
+			const int incremented = classifyCandidate((digits + 1) * unit, low, high, margin);
+			if (truncated < 0 || incremented < 0) {
+				return 0;
+			}
+			if (truncated != 0 || incremented != 0) {
+				const Fixed64 half(unit / 2, (unit & 1) != 0 ? 0x8000000000000000ULL : 0);
+				if ((half < remainder ? remainder - half : half - remainder) < margin) {
+					return 0;
+				}
+				if (half < remainder) {
+					++digits;
+				}
+				done = true;
+			}
+		}
+		if (done) {
+			if (digits < POW10_64[count - 1] || digits >= POW10_64[count]) {
+				return 0;
+			}
+			Char* p = buffer;
+			if ((bits & SIGN) != 0) {
+				*p++ = '-';
+			}
+			const bool eNotation = (exponent < NEGATIVE_E_NOTATION_START || exponent >= POSITIVE_E_NOTATION_START);
+			Char* periodPosition = p + (eNotation || exponent < 0 ? 0 : exponent) + 1;
+			if (!eNotation && exponent < 0) {
+				*p++ = '0';
+				*p++ = '.';
+				while (p < periodPosition - exponent) {
+					*p++ = '0';
+				}
+			}
+			for (int i = count - 1; i >= 0; --i) {
+				if (p == periodPosition) {
+					*p++ = '.';
+				}
+				*p++ = static_cast<Char>('0' + (digits / POW10_64[i]) % 10);
+			}
+			while (p < periodPosition) {
+				*p++ = '0';
+			}
+			if (p == periodPosition) {
+				*p++ = '.';
+				*p++ = '0';
+			}
+			if (eNotation) {
+				p = writeExponent(p, exponent);
+			}
+			assert(p <= buffer + 32);
+			return p;
+		}
+	}
+	return 0;
+}
+
+template<typename T> static Char* digitLoopRealToString(Char buffer[32], const T value) {
+	StandardFPEnvScope standardFPEnv;
+	
+	Char* p = buffer;
+
+	T absValue = value;
+	if (value < 0) {
+		*p++ = '-';
+		absValue = -value;
+	}
+	
+	if (isNaN(absValue)) {
+		strcpy(p, "nan");
+		return p + 3;
+	} else if (absValue == 0.0) {
+		strcpy(p, "0.0");
+		return p + 3;
+	} else if (absValue >= std::numeric_limits<T>::infinity()) {
+		strcpy(p, "inf");
+		return p + 3;
+	}
+
+	// frexp is fast and precise and gives log2(x), log10(x) = log2(x) / log2(10)
+	int base2Exponent;
+	(void) frexp(absValue, &base2Exponent);
+	int exponent = std::max(static_cast<int>(ceil(0.30102999566398119521 * (base2Exponent - 1))) - 1
+			, static_cast<int>(Traits<T>::MIN_EXPONENT));
+	if (exponent < Traits<T>::MAX_EXPONENT) {
+		assert(Traits<double>::MIN_EXPONENT <= exponent + 1 && exponent + 1 <= Traits<double>::MAX_EXPONENT);
+		const double factor = EXP10_TABLE.factors[exponent + 1 - Traits<double>::MIN_EXPONENT];
+		const double magnitude = static_cast<double>(EXP10_TABLE.normals[exponent + 1 - Traits<double>::MIN_EXPONENT]);
+
+		// Notice that in theory we could have a value that is considered equal to next magnitude but should be rounded
 		// downwards (to a lower exponential) and not upwards. However in reality, only the first denormal power of 10
 		// would be a candidate for this, and for both double and single precision floats, they round upwards.
 		if (absValue >= static_cast<T>(magnitude * factor)) {
@@ -695,20 +1506,17 @@ template<typename T> Char* realToString(Char buffer[32], const T value) {
 	}
 
 	if (eNotation) {
-		*p++ = 'e';
-		*p++ = (exponent < 0 ? '-' : '+');
-		int x = (exponent < 0 ? -exponent : exponent);
-		Char* q = buffer + 32;
-		do {
-			*--q = "0123456789"[x % 10];
-		} while ((x /= 10) != 0);
-		assert(q >= p);
-		p = std::copy(q, buffer + 32, p);
+		p = writeExponent(p, exponent);
 	}
 	assert(p <= buffer + 32);
 	return p;
 }
 
+template<typename T> Char* realToString(Char buffer[32], const T value) {
+	Char* p = exactRealToString(buffer, value);
+	return (p != 0 ? p : digitLoopRealToString(buffer, value));
+}
+
 const char* ParsingError::what() const throw() {
 	try {
 		if (errorString.empty()) {
@@ -728,27 +1536,221 @@ const char* ParsingError::what() const throw() {
 	}
 }
 
+const char* SchemaError::what() const throw() {
+	try {
+		if (schemaErrorString.empty()) {
+			schemaErrorString = std::string(ParsingError::what()) + ": " + reason;
+		}
+		return schemaErrorString.c_str();
+	}
+	catch (...) {
+		assert(0);
+		return "exception in Numbstrict::SchemaError::what()";
+	}
+}
+
+LineIndex::LineIndex(const Char* const b, const Char* const e) {
+	lineStarts.push_back(0);
+	const Char* p = b;
+	while (p != e && (p = static_cast<const Char*>(memchr(p, '\n', e - p))) != 0) {
+		++p;
+		lineStarts.push_back(p - b);
+	}
+}
+
+LineAndColumn LineIndex::find(size_t offset) const {
+	const size_t line = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - lineStarts.begin();
+	return LineAndColumn(static_cast<int>(line), static_cast<int>(offset - lineStarts[line - 1] + 1));
+}
+
 LineAndColumn Element::lineAndColumn(const StringIt p) const {
 	assert(exists());
-	LineAndColumn lineAndColumn(1, 1);
-	for (StringIt q = s->first.begin(); q != p; ++q) {
-		assert(q != s->first.end());
-		if (*q == '\n') {
-			++lineAndColumn.first;
-			lineAndColumn.second = 0;
+	assert(p >= s->begin && p <= s->end);
+	std::shared_ptr<const LineIndex> index = std::atomic_load(&s->lineIndex);
+	if (!index) {
+		index = std::make_shared<const LineIndex>(s->begin, s->end);
+		std::atomic_store(&s->lineIndex, index);	// a concurrent call may build an identical one; either is kept
+	}
+	return index->find(p - s->begin);
+}
+
+#ifdef _WIN32
+typedef WideString SystemPath;	// opened with CreateFileW(), so any path can be mapped
+#else
+typedef String SystemPath;	// passed to open() as bytes, so wide paths are encoded as UTF-8
+
+static String encodeUTF8(const WideString& string) {
+	String encoded;
+	for (WideString::const_iterator it = string.begin(); it != string.end(); ++it) {
+		const uint32_t c = static_cast<uint32_t>(*it);
+		if (c < 0x80) {
+			encoded += static_cast<Char>(c);
+		} else if (c < 0x800) {
+			encoded += static_cast<Char>(0xC0 | (c >> 6));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		} else if (c < 0x10000) {
+			encoded += static_cast<Char>(0xE0 | (c >> 12));
+			encoded += static_cast<Char>(0x80 | ((c >> 6) & 0x3F));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		} else {
+			encoded += static_cast<Char>(0xF0 | (c >> 18));
+			encoded += static_cast<Char>(0x80 | ((c >> 12) & 0x3F));
+			encoded += static_cast<Char>(0x80 | ((c >> 6) & 0x3F));
+			encoded += static_cast<Char>(0x80 | (c & 0x3F));
+		}
+	}
+	return encoded;
+}
+#endif
+
+/*
+	Reads what can't be mapped, i.e. pipes, terminals and other devices, and files that report no size (like the ones
+	in procfs). Regular empty files are read too, as they can't be mapped either.
+*/
+#ifdef _WIN32
+static bool readSystemFile(HANDLE file, SourceBuffer& buffer) {
+	const std::shared_ptr<String> contents = std::make_shared<String>();
+	Char chunk[16384];
+	while (true) {
+		DWORD count = 0;
+		if (ReadFile(file, chunk, sizeof (chunk), &count, 0) == 0) {
+			if (GetLastError() != ERROR_BROKEN_PIPE) {	// which is how the end of a pipe reads
+				return false;
+			}
+			break;
+		}
+		if (count == 0) {
+			break;
+		}
+		contents->append(chunk, count);
+	}
+	buffer = SourceBuffer(std::shared_ptr<const String>(contents));
+	return true;
+}
+#else
+static bool readSystemFile(int file, SourceBuffer& buffer) {
+	const std::shared_ptr<String> contents = std::make_shared<String>();
+	Char chunk[16384];
+	ssize_t count;
+	while ((count = read(file, chunk, sizeof (chunk))) != 0) {
+		if (count > 0) {
+			contents->append(chunk, static_cast<size_t>(count));
+		} else if (errno != EINTR) {
+			return false;
 		}
-		++lineAndColumn.second;
 	}
-	return lineAndColumn;
+	buffer = SourceBuffer(std::shared_ptr<const String>(contents));
+	return true;
+}
+#endif
+
+static bool mapSystemPath(const SystemPath& path, SourceBuffer& buffer) {
+#ifdef _WIN32
+	const HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING
+			, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, 0);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	const bool isMappable = (GetFileType(file) == FILE_TYPE_DISK && GetFileSizeEx(file, &fileSize) != 0
+			&& fileSize.QuadPart > 0);
+	if (!isMappable) {
+		const bool ok = readSystemFile(file, buffer);
+		CloseHandle(file);
+		return ok;
+	}
+	if (static_cast<uint64_t>(fileSize.QuadPart) > std::numeric_limits<size_t>::max()) {
+		CloseHandle(file);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(fileSize.QuadPart);
+	const HANDLE mapping = CreateFileMappingW(file, 0, PAGE_READONLY, 0, 0, 0);
+	const void* const address = (mapping != 0 ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : 0);
+	if (mapping != 0) {
+		CloseHandle(mapping);	// the view keeps the mapping open
+	}
+	CloseHandle(file);
+	if (address == 0) {
+		return false;
+	}
+	buffer.owner = std::shared_ptr<const void>(address, [](const void* p) { UnmapViewOfFile(p); });
+#else
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return false;
+	}
+	struct stat status;
+	if (fstat(file, &status) != 0) {
+		close(file);
+		return false;
+	}
+	if (!S_ISREG(status.st_mode) || status.st_size <= 0) {
+		const bool ok = readSystemFile(file, buffer);
+		close(file);
+		return ok;
+	}
+	if (static_cast<uint64_t>(status.st_size) > std::numeric_limits<size_t>::max()) {
+		close(file);
+		return false;
+	}
+	const size_t size = static_cast<size_t>(status.st_size);
+	void* const address = mmap(0, size, PROT_READ, MAP_SHARED, file, 0);
+	close(file);	// the mapping keeps the file open
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	buffer.owner = std::shared_ptr<const void>(address, [size](const void* p) {
+		munmap(const_cast<void*>(p), size);
+	});
+#endif
+	buffer.begin = static_cast<const Char*>(address);
+	buffer.end = buffer.begin + size;
+	return true;
 }
 
-bool Parser::eof() const { return p == source.end(); }
+bool mapFile(const String& path, SourceBuffer& buffer) {
+#ifdef _WIN32
+	WideString widePath;
+	appendChars(widePath, path.data(), path.data() + path.size());	// a String is ISO-8859-1
+	return mapSystemPath(widePath, buffer);
+#else
+	return mapSystemPath(path, buffer);
+#endif
+}
+
+bool mapFile(const WideString& path, SourceBuffer& buffer) {
+#ifdef _WIN32
+	return mapSystemPath(path, buffer);
+#else
+	return mapSystemPath(encodeUTF8(path), buffer);
+#endif
+}
+
+bool Parser::eof() const { return p == e; }
 StringIt Parser::getFailPoint() const { return p; }
-Parser::Parser(const Element& source) : source(source), p(source.begin()) { }
-String::difference_type Parser::left() const { return source.end() - p; }
+Parser::Parser(const Element& source) : source(source), p(source.begin()), e(source.end()) { }
+String::difference_type Parser::left() const { return e - p; }
 
 template<typename T> bool Parser::tryToParseSignedInt(T& i) {
 	whiteAndComments();
+	if (!signedInt(i)) {
+		return false;
+	}
+	whiteAndComments();
+	return eof();
+}
+
+template<typename T> bool Parser::tryToParseUnsignedInt(T& ui) {
+	whiteAndComments();
+	if (!unsignedInt(ui)) {
+		return false;
+	}
+	whiteAndComments();
+	return eof();
+}
+
+// Parses a signed integer at `p` (without surrounding white). False on overflow or if there are no digits.
+template<typename T> bool Parser::signedInt(T& i) {
 	i = 0;
 	int sign = 1;
 	if (!eof() && (*p == '+' || *p == '-')) {
@@ -765,20 +1767,20 @@ template<typename T> bool Parser::tryToParseSignedInt(T& i) {
 		p += 2;
 		int v;
 		while (!eof() && (v = fromHex(*p)) >= 0) {
-			ui = ui * 16 + v;
-			if (ui >= limit) {
+			if (ui > (limit - 1 - v) / 16) {
 				return false;
 			}
+			ui = ui * 16 + v;
 			++p;
 		}
 	} else if (!eof() && *p == '0') {
 		++p;
 	} else {
 		while (!eof() && *p >= '0' && *p <= '9') {
-			ui = ui * 10 + (*p - '0');
-			if (ui >= limit) {
+			if (ui > (limit - 1 - (*p - '0')) / 10) {
 				return false;
 			}
+			ui = ui * 10 + (*p - '0');
 			++p;
 		}
 	}
@@ -788,15 +1790,11 @@ template<typename T> bool Parser::tryToParseSignedInt(T& i) {
 	} else {
 		i = static_cast<T>(ui) * sign;
 	}
-	if (p == b) {
-		return false;
-	}
-	whiteAndComments();
-	return eof();
+	return (p != b);
 }
 
-template<typename T> bool Parser::tryToParseUnsignedInt(T& ui) {
-	whiteAndComments();
+// Parses an unsigned integer at `p` (without surrounding white). False on overflow or if there are no digits.
+template<typename T> bool Parser::unsignedInt(T& ui) {
 	ui = 0;
 	if (!eof() && *p == '+') {
 		++p;
@@ -806,30 +1804,24 @@ template<typename T> bool Parser::tryToParseUnsignedInt(T& ui) {
 		p += 2;
 		int v;
 		while (!eof() && (v = fromHex(*p)) >= 0) {
-			const T lui = ui;
-			ui = ui * 16 + v;
-			if (ui < lui) {
+			if (ui > (std::numeric_limits<T>::max() - v) / 16) {
 				return false;
 			}
+			ui = ui * 16 + v;
 			++p;
 		}
 	} else if (!eof() && *p == '0') {
 		++p;
 	} else {
 		while (!eof() && *p >= '0' && *p <= '9') {
-			const T lui = ui;
-			ui = ui * 10 + (*p - '0');
-			if (ui < lui) {
+			if (ui > (std::numeric_limits<T>::max() - (*p - '0')) / 10) {
 				return false;
 			}
+			ui = ui * 10 + (*p - '0');
 			++p;
 		}
 	}
-	if (p == b) {
-		return false;
-	}
-	whiteAndComments();
-	return eof();
+	return (p != b);
 }
 
 bool Parser::tryToParse(int8_t& i) { return tryToParseSignedInt(i); }
@@ -862,64 +1854,159 @@ void Parser::throwError() {
 	throw ParsingError(source.filename(), offset, lineAndColumn.first, lineAndColumn.second);
 }
 
-bool Parser::comment() {
-	if (left() < 2 || p[0] != '/') {
-		return false;
+/*
+	Returns the end of the comment at `p`, or `p` if there is no comment. Comments also end at invalid control chars (or
+	`e`), and `closed` tells if a block comment was closed properly.
+*/
+template<typename I> I skipComment(I p, const I e, bool& closed) {
+	closed = false;
+	if (e - p < 2 || p[0] != '/') {
+		return p;
 	}
 	if (p[1] == '/') {
-		p += 2;
-		while (!eof() && *p != '\r' && *p != '\n' && (static_cast<UChar>(*p) >= 32 || *p == '\t')) {
-			++p;
-		}
-		return true;
+		return scanChars<LineCommentEndChars>(p + 2, e);
 	} else if (p[1] == '*') {
 		p += 2;
 
 		// Refrain from using recursion when it is easy, to prevent stack overflow.
 		int nestCounter = 1;
-		while (!eof() && nestCounter > 0) {
+		while (nestCounter > 0 && (p = scanChars<BlockCommentSpecialChars>(p, e)) != e) {
 			if (static_cast<UChar>(*p) < 32 && *p != '\r' && *p != '\n' && *p != '\t') {
 				break;
 			}
-			if (left() >= 2 && p[0] == '/' && p[1] == '*') {
+			if (e - p >= 2 && p[0] == '/' && p[1] == '*') {
 				++nestCounter;
 				p += 2;
-			} else if (left() >= 2 && p[0] == '*' && p[1] == '/') {
+			} else if (e - p >= 2 && p[0] == '*' && p[1] == '/') {
 				--nestCounter;
 				p += 2;
 			} else {
 				++p;
 			}
 		}
-		return true;
+		closed = (nestCounter == 0);
+		return p;
 	} else {
+		return p;
+	}
+}
+
+bool Parser::comment() {
+	bool closed;
+	const StringIt end = skipComment(p, e, closed);
+	if (end == p) {
 		return false;
 	}
+	p = end;
+	return true;
 }
 
-bool Parser::whiteAndComments() {
-	const StringIt b = p;
-	while (!eof()) {
-		if (!comment()) {
-			if (!(*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+const size_t StructuralIndex::NONE;
+
+StructuralIndex::StructuralIndex(const Char* const b, const Char* const e) {
+	std::vector<size_t> openBraces;
+	const Char* p = b;
+	while ((p = scanChars<StructuralChars>(p, e)) != e) {
+		const size_t i = offsets.size();
+		add(p - b);
+		switch (*p) {
+			case '{': {
+				openBraces.push_back(i);
+				++p;
 				break;
 			}
-			++p;
+			case '}': {
+				if (!openBraces.empty()) {
+					link(openBraces.back(), i);
+					openBraces.pop_back();
+				}
+				++p;
+				break;
+			}
+			case '\"': case '\'': {
+				p = findEndQuote(p + 1, e, QuoteOrEscapeChars(*p));
+				if (p != e) {
+					add(p - b);
+					link(i, i + 1);
+					++p;
+				}
+				break;
+			}
+			case '/': {
+				bool closed;
+				const Char* const end = skipComment(p, e, closed);
+				if (end == p) {	// just a slash in text
+					offsets.pop_back();
+					partners.pop_back();
+					++p;
+				} else {
+					p = end;
+					if (closed) {
+						add(p - 1 - b);
+						link(i, i + 1);
+					}
+				}
+				break;
+			}
+			default: ++p; break;
+		}
+	}
+	directory.resize((e - b) / DIRECTORY_SPACING + 2);
+	size_t j = 0;
+	for (size_t k = 0; k < directory.size(); ++k) {
+		while (j < offsets.size() && offsets[j] < k * DIRECTORY_SPACING) {
+			++j;
+		}
+		directory[k] = j;
+	}
+}
+
+void StructuralIndex::add(size_t offset) {
+	offsets.push_back(offset);
+	partners.push_back(NONE);
+}
+
+void StructuralIndex::link(size_t opening, size_t closing) {
+	partners[opening] = closing;
+	partners[closing] = opening;
+}
+
+size_t StructuralIndex::find(size_t offset) const {
+	const size_t k = offset / DIRECTORY_SPACING;
+	if (k + 1 >= directory.size()) {
+		return NONE;
+	}
+	const std::vector<size_t>::const_iterator b = offsets.begin() + directory[k];
+	const std::vector<size_t>::const_iterator e = offsets.begin() + directory[k + 1];
+	const std::vector<size_t>::const_iterator it = std::lower_bound(b, e, offset);
+	return (it != e && *it == offset ? it - offsets.begin() : NONE);
+}
+
+void Element::indexStructure() const {
+	assert(exists());
+	if (s->structuralIndex.load() == 0) {
+		// Parsers read the index with a plain atomic load (std::atomic_load() of a shared_ptr would lock on every use).
+		const StructuralIndex* const index = new StructuralIndex(s->begin, s->end);
+		const StructuralIndex* expected = 0;
+		if (!s->structuralIndex.compare_exchange_strong(expected, index)) {
+			delete index;	// a concurrent call stored its identical index first
 		}
 	}
+}
+
+bool Parser::whiteAndComments() {
+	const StringIt b = p;
+	do {
+		p = scanChars<NonWhiteChars>(p, e);
+	} while (comment());
 	return p != b;
 }
 
 bool Parser::horizontalWhiteAndComments() {
 	const StringIt b = p;
-	while (!eof()) {
-		if (!comment()) {
-			if (!(*p == ' ' || *p == '\t')) {
-				break;
-			}
-			++p;
-		}
-	}
+	do {
+		p = scanChars<NonHorizontalWhiteChars>(p, e);
+	} while (comment());
 	return p != b;
 }
 
@@ -960,24 +2047,42 @@ bool Parser::parseIdentifier(String& identifier) {
 	return true;
 }
 
-bool Parser::quotedStringElement(Element& element) {
+/*
+	Jumps past the block or quoted string at `p` with the StructuralIndex of the source, if there is one and it lists `p`
+	as an opening brace or quote. (If the Element begins inside a string or comment, the index and the parser disagree,
+	but where they agree on an opening char they also agree on everything up to its partner.) Returns false if the
+	index can't be used and the caller should scan instead. Otherwise `ok` and `p` are the same as after scanning.
+*/
+bool Parser::skipIndexed(bool& ok) {
+	const StructuralIndex* const index = source.structuralIndex();
+	if (index == 0) {
+		return false;
+	}
+	const size_t offset = source.offset(p);
+	const size_t i = index->find(offset);
+	if (i == StructuralIndex::NONE) {
+		return false;
+	}
+	const size_t partner = index->partner(i);
+	if (partner != StructuralIndex::NONE && partner < i) {	// closing quote
+		return false;
+	}
+	ok = (partner != StructuralIndex::NONE && index->offset(partner) < source.offset(e));
+	p = (ok ? p + (index->offset(partner) + 1 - offset) : e);
+	return true;
+}
+
+bool Parser::skipQuotedString() {
 	assert(!eof() && (*p == '\"' || *p == '\''));
-	const StringIt b = p;
-	const Char quoteChar = *p;
-	++p;
-	while (!eof() && *p != quoteChar) {
-		if (*p == '\\') {
-			++p;
-		}
-		if (!eof()) {
-			++p;
-		}
+	bool ok;
+	if (skipIndexed(ok)) {
+		return ok;
 	}
-	const bool ok = !eof();
+	p = findEndQuote(p + 1, e, QuoteOrEscapeChars(*p));
+	ok = !eof();
 	if (ok) {
 		++p;
 	}
-	element = Element(source, b, p);
 	return ok;
 }
 
@@ -985,7 +2090,7 @@ template<typename C> bool Parser::quotedString(std::basic_string<C>& string) {
 	if (eof() || !(*p == '\"' || *p == '\'')) {
 		return false;
 	}
-	return genericUnquoteString(p, source.end(), string);
+	return genericUnquoteString(p, e, string);
 }
 
 template<typename C> void Parser::unquotedText(std::basic_string<C>& string) {
@@ -999,7 +2104,7 @@ template<typename C> void Parser::unquotedText(std::basic_string<C>& string) {
 			if (!string.empty()) {
 				string += ' ';
 			}
-			string.insert(string.end(), b, p);
+			appendChars(string, b, p);
 		}
 	} while (whiteAndComments());
 }
@@ -1020,64 +2125,191 @@ template<typename C> bool Parser::stringOrText(std::basic_string<C>& string) {
 bool Parser::tryToParse(String& string) { return stringOrText(string); }
 bool Parser::tryToParse(WideString& string) { return stringOrText(string); }
 
-bool Parser::blockElement(Element& element) {
-	element = Element(source, p, p);
-	if (eof() || *p != '{') {
+/*
+	Aliases the source if the quoted string contains nothing that genericUnquoteString() would change or reject,
+	otherwise unescapes to a new String (which also sets `p` to the same fail point as for String on error).
+*/
+bool Parser::quotedString(StringView& view) {
+	if (eof() || !(*p == '\"' || *p == '\'')) {
 		return false;
 	}
-	++p;
-	int nestCounter = 1;
-	while (!eof() && nestCounter > 0) {
-		Element dummy;
-		switch (*p) {
-			case '\"': case '\'': if (!quotedStringElement(dummy)) return false; break;
-			case '/': if (!comment()) ++p; break;
-			case '{': ++nestCounter; ++p; break;
-			case '}': --nestCounter; ++p; break;
-			default: ++p;
-		}
+	const Char quoteChar = *p;
+	const StringIt q = scanChars(p + 1, e, QuotedStringSpecialChars(quoteChar));
+	if (q != e && *q == quoteChar) {
+		view = viewOf(p + 1, q);
+		p = q + 1;
+		return true;
 	}
-	element = Element(element, element.begin(), p);
-	return (nestCounter == 0);
+	const std::shared_ptr<String> unescaped = std::make_shared<String>();
+	const bool ok = genericUnquoteString(p, e, *unescaped);
+	view = StringView(std::shared_ptr<const String>(unescaped));
+	return ok;
 }
 
-bool Parser::unquotedTextElement(Element& element) {
-	element = Element(source, p, p);
+bool Parser::tryToParse(StringView& view) {
+	view = StringView();
+	whiteAndComments();
+	if (!eof() && (*p == '\"' || *p == '\'')) {
+		if (!quotedString(view)) {
+			return false;
+		}
+		whiteAndComments();
+		return eof();
+	}
+	const StringIt b = p;
+	while (!eof() && isTextChar(*p) && !(left() >= 2 && p[0] == '/' && (p[1] == '/' || p[1] == '*'))) {
+		++p;
+	}
+	const StringIt end = p;
+	whiteAndComments();
+	if (eof()) {	// single run of text, i.e. no white to collapse
+		view = viewOf(b, end);
+		return true;
+	}
+	p = b;
+	const std::shared_ptr<String> text = std::make_shared<String>();
+	const bool ok = stringOrText(*text);
+	view = StringView(std::shared_ptr<const String>(text));
+	return ok;
+}
+
+/*
+	Decides if the '{' block at `p` is a struct (rather than an array) by looking ahead at the first entry only. It is a
+	struct if it begins with the special ':' or with a key followed by ':' on the same line. An array can never begin
+	like that, and a struct must, so for valid input this agrees with trying Array first and Struct second.
+*/
+bool Parser::isStructBlock() {
+	assert(!eof() && *p == '{');
+	++p;
+	const bool isStruct = isKeyValueList();
+	--p;
+	return isStruct;
+}
+
+// Same as isStructBlock() for the list that begins at `p`, e.g. a top-level list without braces.
+bool Parser::isKeyValueList() {
+	const StringIt b = p;
+	const bool isStruct = lookAheadKeyValueList();
+	p = b;
+	return isStruct;
+}
+
+// Does the look-ahead of isKeyValueList(), but leaves `p` where it ended.
+bool Parser::lookAheadKeyValueList() {
+	whiteAndComments();
+	bool isStruct = (!eof() && *p == ':');
+	if (!isStruct && !eof()) {
+		bool isKey = false;
+		if (isLeadingIdentifierChar(*p)) {
+			while (!eof() && isIdentifierChar(*p)) {
+				++p;
+			}
+			isKey = true;
+		} else if (*p == '\"' || *p == '\'') {
+			isKey = skipQuotedString();
+		}
+		if (isKey) {
+			horizontalWhiteAndComments();
+			isStruct = (!eof() && *p == ':');
+		}
+	}
+	return isStruct;
+}
+
+bool Parser::skipBlock() {
+	assert(!eof() && *p == '{');
+	bool ok;
+	if (skipIndexed(ok)) {
+		return ok;
+	}
+	++p;
+	int nestCounter = 1;
+	while (!eof() && nestCounter > 0) {
+		switch (*p) {
+			case '\"': case '\'': if (!skipQuotedString()) return false; break;
+			case '/': if (!comment()) ++p; break;
+			case '{': ++nestCounter; ++p; break;
+			case '}': --nestCounter; ++p; break;
+			default: ++p;
+		}
+	}
+	return (nestCounter == 0);
+}
+
+StringIt Parser::skipUnquotedText() {	// returns end of text, i.e. excluding trailing white and comments
+	StringIt end = p;
 	do {
 		StringIt b = p;
 		while (!eof() && isTextChar(*p) && !(left() >= 2 && p[0] == '/' && (p[1] == '/' || p[1] == '*'))) {
 			++p;
 		}
 		if (b != p) {
-			element = Element(element, element.begin(), p);
+			end = p;
 		}
 	} while (horizontalWhiteAndComments());
-	return true;
+	return end;
 }
 
-bool Parser::valueElement(Element& element) {
+// Moves `p` past the value at `p` (and the white and comments after unquoted text) and sets `end` to its end.
+bool Parser::skipValue(StringIt& end) {
+	bool ok = true;
 	if (!eof() && *p == '{') {
-		return blockElement(element);
+		ok = skipBlock();
+		end = p;
 	} else if (!eof() && (*p == '\"' || *p == '\'')) {
-		return quotedStringElement(element);
+		ok = skipQuotedString();
+		end = p;
 	} else if (!eof() && isTextChar(*p)) {
-		return unquotedTextElement(element);
+		end = skipUnquotedText();
 	} else {
-		element = Element(source, p, p);
+		end = p;
+	}
+	return ok;
+}
+
+bool Parser::valueElement(Element& element) {
+	const StringIt b = p;
+	StringIt end;
+	const bool ok = skipValue(end);
+	element = Element(source, b, end);
+	return ok;
+}
+
+bool Parser::parseKey(String& key) {
+	return parseIdentifier(key) || quotedString(key);
+}
+
+bool Parser::parseKey(WideString& key) {
+	const StringIt b = p;
+	if (!eof() && isLeadingIdentifierChar(*p)) {
+		++p;
+		while (!eof() && isIdentifierChar(*p)) {
+			++p;
+		}
+		key.clear();
+		appendChars(key, b, p);
 		return true;
 	}
+	return quotedString(key);
 }
 
-static void toKeyString(String& d, const String& s) { d = s; }
-static void toKeyString(WideString& d, const String& s) { d = WideString(s.begin(), s.end()); }
+bool Parser::parseKey(StringView& key) {
+	const StringIt b = p;
+	if (!eof() && isLeadingIdentifierChar(*p)) {
+		++p;
+		while (!eof() && isIdentifierChar(*p)) {
+			++p;
+		}
+		key = viewOf(b, p);
+		return true;
+	}
+	return quotedString(key);
+}
 
-template<typename C> bool Parser::keyValuePair(std::map<std::basic_string<C>, Element>& elements) {
-	std::pair<std::basic_string<C>, Element> kv;
+template<typename S> bool Parser::keyValuePair(S& elements) {
+	std::pair<typename S::key_type, Element> kv;
 	const StringIt b1 = p;
-	String identifier;
-	if (parseIdentifier(identifier)) {
-		toKeyString(kv.first, identifier);
-	} else if (!quotedString(kv.first)) {
+	if (!parseKey(kv.first)) {
 		return false;
 	}
 	horizontalWhiteAndComments();
@@ -1091,7 +2323,7 @@ template<typename C> bool Parser::keyValuePair(std::map<std::basic_string<C>, El
 		return false;
 	}
 	horizontalWhiteAndComments();
-	if (!elements.insert(kv).second) {
+	if (!elements.insert(std::move(kv)).second) {
 		p = b1;
 		return false;
 	}
@@ -1112,7 +2344,7 @@ bool Parser::nextElement() {
 	return optionalComma;
 }
 
-template<typename C> bool Parser::keyValueElements(std::map<std::basic_string<C>, Element>& elements) {
+template<typename S> bool Parser::keyValueElements(S& elements) {
 	if (!eof() && *p == ':') {	// special empty struct syntax { : }
 		++p;
 		whiteAndComments();
@@ -1174,6 +2406,39 @@ bool Parser::tryToParse(WideStruct& elements) {
 	return tryToParseStruct(elements);
 }
 
+bool Parser::tryToParse(ViewStruct& elements) {
+	return tryToParseStruct(elements);
+}
+
+/*
+	Parses through a BasicHashStruct (reusing the vector of `elements`) so that duplicate keys are detected at once (with
+	the same fail point as for Struct), then sorts once. Keys are unique so there is no need for a stable sort.
+*/
+template<typename K> bool Parser::tryToParseFlatStruct(BasicFlatStruct<K>& elements) {
+	BasicHashStruct<K> members;
+	members.members.swap(elements.members);
+	const bool ok = tryToParseStruct(members);
+	elements.members.swap(members.members);
+	std::sort(elements.members.begin(), elements.members.end(), typename BasicFlatStruct<K>::KeyOrder());
+	return ok;
+}
+
+bool Parser::tryToParse(FlatStruct& elements) {
+	return tryToParseFlatStruct(elements);
+}
+
+bool Parser::tryToParse(WideFlatStruct& elements) {
+	return tryToParseFlatStruct(elements);
+}
+
+bool Parser::tryToParse(HashStruct& elements) {
+	return tryToParseStruct(elements);
+}
+
+bool Parser::tryToParse(WideHashStruct& elements) {
+	return tryToParseStruct(elements);
+}
+
 bool Parser::tryToParse(Array& elements) {
 	elements.clear();
 	whiteAndComments();
@@ -1196,15 +2461,212 @@ bool Parser::tryToParse(Array& elements) {
 	return eof();
 }
 
+/*
+	Scans the members of a Cursor one at a time, continuing where the last scan ended. It follows tryToParseStruct() and
+	tryToParse(Array&) step by step, so errors are reported at the same offsets, except that duplicate keys are not
+	detected.
+*/
+class MemberParser : public Parser {
+	public:
+		MemberParser(const Element& code, Cursor::Members& members) : Parser(code), members(members) { }
+		void next();
+
+	protected:
+		void finish();
+		Cursor::Members& members;
+};
+
+void MemberParser::next() {
+	assert(!members.complete);
+	if (members.started) {
+		p = members.next;
+	} else {
+		members.started = true;
+		whiteAndComments();
+		members.braced = (!eof() && *p == '{');
+		members.isStruct = (members.braced ? isStructBlock() : isKeyValueList());
+		if (members.braced) {
+			++p;
+			whiteAndComments();
+		}
+		if (members.isStruct && !eof() && *p == ':') {	// special empty struct syntax { : }
+			++p;
+			whiteAndComments();
+			finish();
+			return;
+		}
+	}
+	if (eof() || *p == '}') {
+		finish();
+		return;
+	}
+	bool ok;
+	if (members.isStruct) {
+		ok = keyValuePair(members);
+	} else {
+		Element v(source, p, p);
+		ok = valueElement(v);
+		if (ok) {
+			horizontalWhiteAndComments();
+			members.values.push_back(v);
+		}
+	}
+	if (!ok || !nextElement()) {
+		throwError();
+	}
+	members.next = p;
+}
+
+void MemberParser::finish() {
+	if (members.braced) {
+		if (eof() || *p != '}') {
+			throwError();
+		}
+		++p;
+		whiteAndComments();
+	}
+	if (!eof()) {
+		throwError();
+	}
+	members.complete = true;
+}
+
+std::pair<size_t, bool> Cursor::Members::insert(std::pair<StringView, Element>&& member) {
+	keys.push_back(std::move(member.first));
+	values.push_back(member.second);
+	return std::make_pair(values.size() - 1, true);
+}
+
+bool Cursor::scanned(size_t i) const {
+	assert(exists());
+	if (i >= members->values.size() && !members->complete) {
+		MemberParser parser(code, *members);
+		do {
+			parser.next();
+		} while (i >= members->values.size() && !members->complete);
+	}
+	return (i < members->values.size());
+}
+
+Cursor Cursor::operator[](size_t i) const {
+	return (exists() && scanned(i) ? Cursor(members->values[i]) : Cursor());
+}
+
+Cursor Cursor::operator[](const String& key) const {
+	if (!exists()) {
+		return Cursor();
+	}
+	const StringView view(key);
+	for (size_t i = 0; scanned(i) && members->isStruct; ++i) {
+		if (members->keys[i] == view) {
+			return Cursor(members->values[i]);
+		}
+	}
+	return Cursor();
+}
+
+size_t Cursor::size() const {
+	if (!exists()) {
+		return 0;
+	}
+	scanned(std::numeric_limits<size_t>::max());
+	return members->values.size();
+}
+
+Cursor Element::operator[](size_t i) const { return Cursor(*this)[i]; }
+Cursor Element::operator[](const String& key) const { return Cursor(*this)[key]; }
+Cursor Element::operator[](const Char* key) const { return Cursor(*this)[String(key)]; }
+
+Variant::Variant(const Variant& other) : kind(INVALID) {
+	*this = other;
+}
+
+Variant& Variant::operator=(const Variant& other) {
+	if (this != &other) {
+		switch (other.kind) {
+			case STRUCT: setStruct() = *other.value.structure; break;
+			case ARRAY: setArray() = *other.value.array; break;
+			case TEXT: setText() = *other.value.text; break;
+			default: {
+				clear();
+				kind = other.kind;
+				value = other.value;
+				break;
+			}
+		}
+	}
+	return *this;
+}
+
+Variant& Variant::operator=(Variant&& other) {
+	if (this != &other) {
+		clear();
+		kind = other.kind;
+		value = other.value;
+		other.kind = INVALID;
+	}
+	return *this;
+}
+
+void Variant::clear() {
+	switch (kind) {
+		case STRUCT: delete value.structure; break;
+		case ARRAY: delete value.array; break;
+		case TEXT: delete value.text; break;
+		default: break;
+	}
+	kind = INVALID;
+}
+
+WideStruct& Variant::setStruct() {
+	if (kind == STRUCT) {
+		value.structure->clear();
+	} else {
+		WideStruct* const structure = new WideStruct();
+		clear();
+		kind = STRUCT;
+		value.structure = structure;
+	}
+	return *value.structure;
+}
+
+Array& Variant::setArray() {
+	if (kind == ARRAY) {
+		value.array->clear();
+	} else {
+		Array* const array = new Array();
+		clear();
+		kind = ARRAY;
+		value.array = array;
+	}
+	return *value.array;
+}
+
+WideString& Variant::setText() {
+	if (kind == TEXT) {
+		value.text->clear();
+	} else {
+		WideString* const text = new WideString();
+		clear();
+		kind = TEXT;
+		value.text = text;
+	}
+	return *value.text;
+}
+
+/*
+	Decides the type without trial parses: numbers with classifyNumber() and '{' blocks with isStructBlock(), so valid
+	input is parsed once. Only the container of the type that is parsed is allocated (see Variant).
+*/
 bool Parser::tryToParse(Variant& toVariant) {
-	toVariant = Variant();
 	whiteAndComments();
 	if (!eof()) {
 		const StringIt b = p;
 		switch (*p) {
 			case 't': case 'f': {
-				if (tryToParse(toVariant.boolean)) {
-					toVariant.type = Variant::BOOLEAN;
+				bool boolean;
+				if (tryToParse(boolean)) {
+					toVariant.setBoolean(boolean);
 					return true;
 				}
 				break;
@@ -1214,171 +2676,2421 @@ bool Parser::tryToParse(Variant& toVariant) {
 			case '+': case '-':
 			case '0': case '1': case '2': case '3': case '4':
 			case '5': case '6': case '7': case '8': case '9': {
-				if (tryToParse(toVariant.integer)) {
-					toVariant.type = Variant::INTEGER;
-					return true;
-				}
-				p = b;
-				if (tryToParse(toVariant.unsignedInteger)) {
-					toVariant.type = Variant::UNSIGNED_INTEGER;
-					return true;
-				}
-				p = b;
-				if (tryToParse(toVariant.real)) {
-					toVariant.type = Variant::REAL;
-					return true;
+				int64_t integer;
+				uint64_t unsignedInteger;
+				double real;
+				switch (classifyNumber(integer, unsignedInteger, real)) {
+					case Variant::INTEGER: toVariant.setInteger(integer); return true;
+					case Variant::UNSIGNED_INTEGER: toVariant.setUnsignedInteger(unsignedInteger); return true;
+					case Variant::REAL: toVariant.setReal(real); return true;
+					default: break;
 				}
 				break;
 			}
 			case '{': {
-				if (tryToParse(toVariant.array)) {
-					toVariant.type = Variant::ARRAY;
+				if (isStructBlock() ? tryToParse(toVariant.setStruct()) : tryToParse(toVariant.setArray())) {
 					return true;
 				}
 				p = b;
-				if (tryToParse(toVariant.structure)) {
-					toVariant.type = Variant::STRUCT;
-					return true;
-				}
+				tryToParse(toVariant.setStruct());	// an invalid block is reported where parsing it as a struct fails
+				toVariant.clear();
 				return false;
 			}
 		}
 		p = b;
 	}
-	if (tryToParse(toVariant.text)) {
-		toVariant.type = Variant::TEXT;
+	if (tryToParse(toVariant.setText())) {
 		return true;
 	}
+	toVariant.clear();
 	return false;
 }
 
-template<typename T> bool Parser::tryToParseReal(T& r) {
-	whiteAndComments();
-	if (eof()) {
-		return false;
+Arena::~Arena() {
+	while (last != 0) {
+		Block* const previous = last->previous;
+		::operator delete(last);
+		last = previous;
+	}
+}
+
+void* Arena::allocate(size_t size) {
+	const size_t ALIGNMENT = 8;
+	static_assert(sizeof (Block) % ALIGNMENT == 0, "Arena::Block must keep alignment");
+	size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+	if (size > left) {
+		const size_t blockSize = std::max(size, (last != 0 ? last->size * 2 : 4096 - sizeof (Block)));
+		Block* const block = static_cast<Block*>(::operator new(sizeof (Block) + blockSize));
+		++allocationCount;
+		block->previous = last;
+		block->size = blockSize;
+		last = block;
+		next = reinterpret_cast<char*>(block + 1);
+		left = blockSize;
+	}
+	void* const allocated = next;
+	next += size;
+	left -= size;
+	return allocated;
+}
+
+void Arena::clear() {
+	if (last != 0 && last->previous != 0) {
+		size_t total = 0;
+		while (last != 0) {
+			Block* const previous = last->previous;
+			total += last->size;
+			::operator delete(last);
+			last = previous;
+		}
+		left = 0;
+		allocate(total);
+	}
+	if (last != 0) {
+		next = reinterpret_cast<char*>(last + 1);
+		left = last->size;
+	}
+}
+
+/*
+	Builds a Document in a single pass. Values are classified just like Parser::tryToParse(Variant&) does, but nested
+	blocks are descended into directly (without recursion) instead of being skipped and re-scanned later. Children of
+	open blocks are collected in `pending` and are copied to the arena in one go when their block closes. That way the
+	children of every node end up contiguous. Duplicate keys are detected by comparing with the preceding siblings in
+	small structs and with a single hash table shared by all large structs.
+*/
+class DocumentParser : public Parser {
+	public:
+		DocumentParser(const Parser& parser, Document& document) : Parser(parser), document(document), keyCount(0) { }
+		bool parse();
+
+	protected:
+		typedef Document::NodeData NodeData;
+		struct Block {
+			size_t node;			// index of block node in `pending`
+			size_t mark;			// index of first child in `pending`
+			bool isStruct;
+			StringIt keyBegin;		// start of last member key (for reporting duplicates)
+		};
+		struct KeySlot {
+			size_t block;			// begin offset of owning block + 1, 0 for empty slots
+			size_t hash;
+			const WideChar* key;
+			size_t length;
+		};
+		struct KeyOrder {	// orders indices into `pending` by key (sorting indices is cheaper than moving nodes)
+			KeyOrder(const NodeData* nodes) : nodes(nodes) { }
+			bool operator()(size_t a, size_t b) const {
+				const NodeData& x = nodes[a];
+				const NodeData& y = nodes[b];
+				return std::lexicographical_compare(x.key, x.key + x.keyLength, y.key, y.key + y.keyLength);
+			}
+			const NodeData* nodes;
+		};
+		size_t offset(const StringIt i) const { return i - document.code.begin(); }
+		const WideChar* store(const WideString& s);
+		bool value(size_t node);
+		bool scalar(size_t node, StringIt b, StringIt q);
+		bool key(size_t node);
+		bool insertKey(const NodeData& member, size_t block);
+		bool isUniqueKey(const Block& block);
+		bool nextMember();
+		void closeBlock();
+		Document& document;
+		Arena* arena;
+		std::vector<NodeData> pending;
+		std::vector<Block> blocks;
+		std::vector<KeySlot> keySlots;
+		size_t keyCount;
+		std::vector<size_t> order;
+		WideString text;
+};
+
+static size_t hashKey(const WideChar* s, size_t n, size_t seed) {
+	uint64_t h = 14695981039346656037ULL ^ seed;
+	for (size_t i = 0; i < n; ++i) {
+		h = (h ^ static_cast<uint64_t>(s[i])) * 1099511628211ULL;
+	}
+	h = (h ^ (h >> 33)) * 0xFF51AFD7ED558CCDULL;	// FNV-1a alone leaves the low bits (used for slots) poorly mixed
+	return static_cast<size_t>(h ^ (h >> 33));
+}
+
+const WideChar* DocumentParser::store(const WideString& s) {
+	WideChar* const stored = arena->allocate<WideChar>(s.size());
+	std::copy(s.begin(), s.end(), stored);
+	return stored;
+}
+
+bool DocumentParser::scalar(size_t node, const StringIt b, const StringIt q) {
+	NodeData& data = pending[node];
+	data.begin = offset(b);
+	data.end = offset(q);
+	const StringIt limit = e;
+	e = q;
+	p = b;
+	bool ok = false;
+	if (!eof()) {
+		switch (*p) {
+			case 't': case 'f': {
+				data.type = Variant::BOOLEAN;
+				ok = tryToParse(data.boolean);
+				break;
+			}
+			case 'i': // inf
+			case 'n': // nan
+			case '+': case '-':
+			case '0': case '1': case '2': case '3': case '4':
+			case '5': case '6': case '7': case '8': case '9': {
+				int64_t integer;
+				uint64_t unsignedInteger;
+				double real;
+				data.type = classifyNumber(integer, unsignedInteger, real);
+				switch (data.type) {
+					case Variant::INTEGER: data.integer = integer; ok = true; break;
+					case Variant::UNSIGNED_INTEGER: data.unsignedInteger = unsignedInteger; ok = true; break;
+					case Variant::REAL: data.real = real; ok = true; break;
+					default: break;
+				}
+				break;
+			}
+		}
+	}
+	if (!ok) {
+		p = b;
+		ok = stringOrText(text);
+		data.type = Variant::TEXT;
+		data.text = store(text);
+		data.count = text.size();
+	}
+	e = limit;
+	return ok;
+}
+
+bool DocumentParser::value(size_t node) {
+	if (!eof() && *p == '{') {
+		const bool isStruct = isStructBlock();
+		pending[node].type = (isStruct ? Variant::STRUCT : Variant::ARRAY);
+		pending[node].begin = offset(p);
+		++p;
+		whiteAndComments();
+		if (isStruct && !eof() && *p == ':') {	// special empty struct syntax { : }
+			++p;
+			whiteAndComments();
+			if (eof() || *p != '}') {
+				return false;
+			}
+		}
+		const Block block = { node, pending.size(), isStruct, p };
+		blocks.push_back(block);
+		return true;
+	} else if (!eof() && (*p == '\"' || *p == '\'')) {
+		const StringIt b = p;
+		return skipQuotedString() && scalar(node, b, p);
+	} else if (!eof() && isTextChar(*p)) {
+		const StringIt b = p;
+		return scalar(node, b, skipUnquotedText());
+	} else {
+		return scalar(node, p, p);
+	}
+}
+
+bool DocumentParser::key(size_t node) {
+	NodeData& data = pending[node];
+	blocks.back().keyBegin = p;
+	if (!eof() && isLeadingIdentifierChar(*p)) {
+		const StringIt b = p;
+		while (!eof() && isIdentifierChar(*p)) {
+			++p;
+		}
+		WideChar* const stored = arena->allocate<WideChar>(p - b);
+		std::copy(b, p, stored);
+		data.key = stored;
+		data.keyLength = p - b;
+	} else {
+		text.clear();
+		if (!quotedString(text)) {
+			return false;
+		}
+		data.key = store(text);
+		data.keyLength = text.size();
+	}
+	horizontalWhiteAndComments();
+	if (eof() || *p != ':') {
+		return false;
+	}
+	++p;
+	horizontalWhiteAndComments();
+	return true;
+}
+
+bool DocumentParser::insertKey(const NodeData& member, size_t block) {
+	if ((keyCount + 1) * 2 > keySlots.size()) {
+		std::vector<KeySlot> slots(std::max<size_t>(keySlots.size() * 2, 64));
+		const size_t mask = slots.size() - 1;
+		for (std::vector<KeySlot>::const_iterator it = keySlots.begin(); it != keySlots.end(); ++it) {
+			if (it->block != 0) {
+				size_t i = it->hash & mask;
+				while (slots[i].block != 0) {
+					i = (i + 1) & mask;
+				}
+				slots[i] = *it;
+			}
+		}
+		keySlots.swap(slots);
+	}
+	const size_t mask = keySlots.size() - 1;
+	const size_t hash = hashKey(member.key, member.keyLength, block);
+	size_t i = hash & mask;
+	while (keySlots[i].block != 0) {
+		const KeySlot& slot = keySlots[i];
+		if (slot.hash == hash && slot.block == block && slot.length == member.keyLength
+				&& std::equal(member.key, member.key + member.keyLength, slot.key)) {
+			return false;
+		}
+		i = (i + 1) & mask;
+	}
+	const KeySlot slot = { block, hash, member.key, member.keyLength };
+	keySlots[i] = slot;
+	++keyCount;
+	return true;
+}
+
+bool DocumentParser::isUniqueKey(const Block& block) {
+	const size_t LINEAR_SEARCH_LIMIT = 16;
+	const NodeData& member = pending.back();
+	const size_t count = pending.size() - block.mark;
+	if (count <= LINEAR_SEARCH_LIMIT) {
+		for (size_t i = block.mark; i + 1 < pending.size(); ++i) {
+			if (pending[i].keyLength == member.keyLength
+					&& std::equal(member.key, member.key + member.keyLength, pending[i].key)) {
+				return false;
+			}
+		}
+		return true;
+	}
+	const size_t id = pending[block.node].begin + 1;
+	if (count == LINEAR_SEARCH_LIMIT + 1) {
+		for (size_t i = block.mark; i + 1 < pending.size(); ++i) {
+			insertKey(pending[i], id);
+		}
+	}
+	return insertKey(member, id);
+}
+
+bool DocumentParser::nextMember() {
+	const Block& block = blocks.back();
+	horizontalWhiteAndComments();
+	if (block.isStruct && !isUniqueKey(block)) {
+		p = block.keyBegin;
+		return false;
+	}
+	return nextElement();
+}
+
+void DocumentParser::closeBlock() {
+	if (!eof()) {	// else it is the end of a root key/value list without braces
+		assert(*p == '}');
+		++p;
+	}
+	const Block block = blocks.back();
+	blocks.pop_back();
+	NodeData& data = pending[block.node];
+	data.end = offset(p);
+	data.count = pending.size() - block.mark;
+	NodeData* const children = arena->allocate<NodeData>(data.count);
+	if (block.isStruct) {
+		order.resize(data.count);
+		for (size_t i = 0; i < data.count; ++i) {
+			order[i] = block.mark + i;
+		}
+		const KeyOrder keyOrder(pending.data());
+		if (!std::is_sorted(order.begin(), order.end(), keyOrder)) {
+			std::sort(order.begin(), order.end(), keyOrder);
+		}
+		for (size_t i = 0; i < data.count; ++i) {
+			children[i] = pending[order[i]];
+		}
+	} else {
+		std::copy(pending.begin() + block.mark, pending.end(), children);
+	}
+	data.children = children;
+	pending.resize(block.mark);
+}
+
+bool DocumentParser::parse() {
+	if (document.arena && document.arena.use_count() == 1) {
+		document.arena->clear();
+	} else {
+		document.arena = std::make_shared<Arena>();
+	}
+	arena = document.arena.get();
+	document.code = Element(source, p, e);
+	document.rootData = 0;
+	pending.assign(1, NodeData());
+	whiteAndComments();
+	bool ok = true;
+	bool isRootList = false;	// a key/value list without braces, which ends at the end of input
+	if (!eof() && *p == '{') {
+		ok = value(0);
+	} else if (isKeyValueList()) {
+		isRootList = true;
+		pending[0].type = Variant::STRUCT;
+		pending[0].begin = offset(p);
+		if (*p == ':') {	// special empty struct syntax
+			++p;
+			whiteAndComments();
+			ok = eof();
+		}
+		const Block block = { 0, pending.size(), true, p };
+		blocks.push_back(block);
+	} else {
+		ok = scalar(0, p, e);
+	}
+	while (ok && !blocks.empty()) {
+		if (eof()) {
+			ok = (isRootList && blocks.size() == 1);
+			if (ok) {
+				closeBlock();
+			}
+		} else if (*p == '}') {
+			ok = !(isRootList && blocks.size() == 1);
+			if (ok) {
+				closeBlock();
+				ok = (blocks.empty() || nextMember());
+			}
+		} else {
+			const size_t node = pending.size();
+			pending.push_back(NodeData());
+			ok = ((!blocks.back().isStruct || key(node)) && value(node));
+			if (ok && blocks.back().node != node) {
+				ok = nextMember();
+			}
+		}
+	}
+	if (ok) {
+		whiteAndComments();
+		ok = eof();
+	}
+	if (ok) {
+		NodeData* const root = arena->allocate<NodeData>(1);
+		*root = pending[0];
+		document.rootData = root;
+	}
+	return ok;
+}
+
+bool Parser::tryToParse(Document& document) {
+	DocumentParser parser(*this, document);
+	const bool ok = parser.parse();
+	p = parser.getFailPoint();
+	return ok;
+}
+
+/*
+	Parses the pending input of a StreamParser with the same steps as DocumentParser, one member (or closing brace) at a
+	time. No scan looks more than one char past where it stops, so a step that stops at least two chars before the end
+	of the chunk does not depend on input that hasn't arrived yet. Such a step is committed and its events reported.
+	Otherwise it is rolled back and parsed again once there is more input (or at finish()).
+*/
+class StreamChunkParser : public Parser {
+	public:
+		StreamChunkParser(const Element& chunk, StreamParser& stream)
+				: Parser(chunk), stream(stream), tracked(chunk.begin()), trackedLineAndColumn(stream.lineAndColumn)
+				, failedAtKey(false), failOffset(0) { }
+		void parse();	// throws ParsingError, leaves the rest of the input in `stream.pending`
+
+	protected:
+		enum Step { COMMITTED, INCOMPLETE, FAILED };
+		bool incomplete() const { return !stream.finished && e - p < 2; }
+		Step root();
+		Step openBlock(bool& isStruct);
+		Step member();
+		Step closeBlock();
+		Step nextMember(const StreamParser::Block& block, const WideString& key, StringIt keyBegin);
+		Step trailing();
+		void beginBlock(bool isStruct, bool isMember, StringIt keyBegin);
+		bool isValidQuotedString(StringIt b, StringIt q);
+		LineAndColumn lineAndColumnAt(StringIt q);
+		StreamParser& stream;
+		StreamHandler& handler() { return stream.handler; }
+		StringIt tracked;
+		LineAndColumn trackedLineAndColumn;		// of `tracked`
+		bool failedAtKey;						// for duplicate keys of blocks (that may begin in an earlier chunk)
+		size_t failOffset;
+		LineAndColumn failLineAndColumn;
+		WideString key;
+		WideString text;
+};
+
+LineAndColumn StreamChunkParser::lineAndColumnAt(const StringIt q) {
+	if (q < tracked) {
+		tracked = source.begin();
+		trackedLineAndColumn = stream.lineAndColumn;
+	}
+	for (; tracked != q; ++tracked) {
+		if (*tracked == '\n') {
+			++trackedLineAndColumn.first;
+			trackedLineAndColumn.second = 0;
+		}
+		++trackedLineAndColumn.second;
+	}
+	return trackedLineAndColumn;
+}
+
+// Same validation as stringOrText() does for the quoted string [b, q), but without unquoting when nothing is escaped.
+bool StreamChunkParser::isValidQuotedString(const StringIt b, const StringIt q) {
+	if (scanChars(b + 1, q, QuotedStringSpecialChars(*b)) == q - 1) {
+		return true;
+	}
+	const StringIt limit = e;
+	e = q;
+	p = b;
+	text.clear();
+	const bool ok = genericUnquoteString(p, e, text);
+	e = limit;
+	return ok;
+}
+
+StreamChunkParser::Step StreamChunkParser::openBlock(bool& isStruct) {
+	assert(!eof() && *p == '{');
+	const StringIt b = p;
+	++p;
+	isStruct = lookAheadKeyValueList();
+	if (incomplete()) {
+		return INCOMPLETE;
+	}
+	p = b + 1;
+	whiteAndComments();
+	if (isStruct && !eof() && *p == ':') {	// special empty struct syntax { : }
+		++p;
+		whiteAndComments();
+		if (incomplete()) {
+			return INCOMPLETE;
+		}
+		if (eof() || *p != '}') {
+			return FAILED;
+		}
+	}
+	return COMMITTED;
+}
+
+void StreamChunkParser::beginBlock(const bool isStruct, const bool isMember, const StringIt keyBegin) {
+	if (stream.depth == stream.blocks.size()) {
+		stream.blocks.push_back(StreamParser::Block());
+	}
+	StreamParser::Block& block = stream.blocks[stream.depth];
+	++stream.depth;
+	block.isStruct = isStruct;
+	block.keyCount = 0;
+	block.keyIndex.clear();
+	if (isMember) {
+		block.key.swap(key);
+		block.keyOffset = stream.offset + (keyBegin - source.begin());
+		block.keyLineAndColumn = lineAndColumnAt(keyBegin);
+		handler().key(block.key);
+	}
+	if (isStruct) {
+		handler().beginStruct();
+	} else {
+		handler().beginArray();
+	}
+}
+
+StreamChunkParser::Step StreamChunkParser::root() {
+	whiteAndComments();
+	if (incomplete()) {
+		return INCOMPLETE;
+	}
+	if (!eof() && *p == '{') {
+		bool isStruct;
+		const Step step = openBlock(isStruct);
+		if (step == COMMITTED) {
+			stream.started = true;
+			beginBlock(isStruct, false, p);
+		}
+		return step;
+	}
+	const StringIt b = p;
+	const bool isStruct = lookAheadKeyValueList();		// a key/value list without braces, ends at the end of input
+	if (incomplete()) {
+		return INCOMPLETE;
+	}
+	p = b;
+	if (isStruct) {
+		stream.started = true;
+		if (*p == ':') {	// special empty struct syntax
+			++p;
+			handler().beginStruct();
+			handler().endStruct();
+		} else {
+			stream.unbracedRoot = true;
+			beginBlock(true, false, p);
+		}
+		return COMMITTED;
+	}
+	if (!stream.finished) {		// any other root value extends to the end of input
+		return INCOMPLETE;
+	}
+	text.clear();
+	if (!stringOrText(text)) {
+		return FAILED;
+	}
+	stream.started = true;
+	handler().scalar(Element(source, b, e));
+	return COMMITTED;
+}
+
+StreamChunkParser::Step StreamChunkParser::nextMember(const StreamParser::Block& block, const WideString& key
+		, const StringIt keyBegin) {
+	horizontalWhiteAndComments();
+	if (block.isStruct && block.hasKey(key)) {
+		p = keyBegin;
+		return FAILED;
+	}
+	const bool ok = nextElement();
+	if (incomplete()) {
+		return INCOMPLETE;
+	}
+	return (ok ? COMMITTED : FAILED);
+}
+
+StreamChunkParser::Step StreamChunkParser::member() {
+	StreamParser::Block& block = stream.blocks[stream.depth - 1];
+	const StringIt keyBegin = p;
+	if (block.isStruct) {
+		key.clear();
+		if (isLeadingIdentifierChar(*p)) {
+			while (!eof() && isIdentifierChar(*p)) {
+				++p;
+			}
+			appendChars(key, keyBegin, p);
+		} else if (!quotedString(key)) {
+			return (eof() && !stream.finished ? INCOMPLETE : FAILED);
+		}
+		horizontalWhiteAndComments();
+		if (incomplete()) {
+			return INCOMPLETE;
+		}
+		if (eof() || *p != ':') {
+			return FAILED;
+		}
+		++p;
+		horizontalWhiteAndComments();
+		if (incomplete()) {
+			return INCOMPLETE;
+		}
+	}
+	if (!eof() && *p == '{') {
+		bool isStruct;
+		const Step step = openBlock(isStruct);
+		if (step == COMMITTED) {
+			beginBlock(isStruct, block.isStruct, keyBegin);
+		}
+		return step;
+	}
+	const StringIt b = p;
+	StringIt q = p;
+	if (!eof() && (*p == '\"' || *p == '\'')) {
+		if (!skipQuotedString()) {
+			return (stream.finished ? FAILED : INCOMPLETE);
+		}
+		q = p;
+		if (!isValidQuotedString(b, q)) {
+			return FAILED;
+		}
+		p = q;
+	} else if (!eof() && isTextChar(*p)) {
+		q = skipUnquotedText();		// unquoted text is always valid (DocumentParser::scalar() can't fail on it)
+	}
+	const Step step = nextMember(block, key, keyBegin);
+	if (step == COMMITTED) {
+		if (block.isStruct) {
+			handler().key(key);
+			block.addKey(key);
+		}
+		handler().scalar(Element(source, b, q));
+	}
+	return step;
+}
+
+StreamChunkParser::Step StreamChunkParser::closeBlock() {
+	assert(!eof() && *p == '}');
+	++p;
+	StreamParser::Block& block = stream.blocks[stream.depth - 1];
+	if (stream.depth >= 2) {
+		StreamParser::Block& parent = stream.blocks[stream.depth - 2];
+		horizontalWhiteAndComments();
+		if (parent.isStruct && parent.hasKey(block.key)) {
+			failedAtKey = true;
+			failOffset = block.keyOffset;
+			failLineAndColumn = block.keyLineAndColumn;
+			return FAILED;
+		}
+		const bool ok = nextElement();
+		if (incomplete()) {
+			return INCOMPLETE;
+		}
+		if (!ok) {
+			return FAILED;
+		}
+		if (parent.isStruct) {
+			parent.addKey(block.key);
+		}
+	}
+	--stream.depth;
+	if (block.isStruct) {
+		handler().endStruct();
+	} else {
+		handler().endArray();
+	}
+	return COMMITTED;
+}
+
+StreamChunkParser::Step StreamChunkParser::trailing() {
+	whiteAndComments();
+	if (incomplete()) {
+		return INCOMPLETE;
+	}
+	return (eof() ? COMMITTED : FAILED);
+}
+
+void StreamChunkParser::parse() {
+	StringIt committed = p;
+	Step step = COMMITTED;
+	while (step == COMMITTED && !(stream.started && stream.depth == 0 && eof())) {
+		if (!stream.started) {
+			step = root();
+		} else if (stream.depth == 0) {
+			step = trailing();
+		} else if (eof()) {
+			if (!stream.finished) {
+				step = INCOMPLETE;
+			} else if (stream.depth == 1 && stream.unbracedRoot) {
+				--stream.depth;
+				handler().endStruct();
+			} else {
+				step = FAILED;
+			}
+		} else if (*p == '}') {
+			step = (stream.depth == 1 && stream.unbracedRoot ? FAILED : closeBlock());
+		} else {
+			step = member();
+		}
+		if (step == COMMITTED) {
+			committed = p;
+		}
+	}
+	if (step == FAILED) {
+		if (!failedAtKey) {
+			failOffset = stream.offset + (p - source.begin());
+			failLineAndColumn = lineAndColumnAt(p);
+		}
+		throw ParsingError(stream.filename, failOffset, failLineAndColumn.first, failLineAndColumn.second);
+	}
+	stream.lineAndColumn = lineAndColumnAt(committed);
+	stream.offset += committed - source.begin();
+	stream.pending.erase(0, committed - source.begin());
+}
+
+StreamParser::StreamParser(StreamHandler& handler, const String& filename)
+		: handler(handler), filename(filename), offset(0), lineAndColumn(1, 1), retrySize(0), started(false)
+		, unbracedRoot(false), finished(false), depth(0) { }
+
+bool StreamParser::Block::hasKey(const WideString& key) const {
+	if (!keyIndex.empty()) {
+		return (keyIndex.find(key) != keyIndex.end());
+	}
+	return (std::find(keys.begin(), keys.begin() + keyCount, key) != keys.begin() + keyCount);
+}
+
+void StreamParser::Block::addKey(const WideString& key) {
+	const size_t LINEAR_SEARCH_LIMIT = 16;
+	if (keyIndex.empty() && keyCount < LINEAR_SEARCH_LIMIT) {
+		if (keyCount == keys.size()) {
+			keys.push_back(key);
+		} else {
+			keys[keyCount] = key;
+		}
+		++keyCount;
+	} else {
+		if (keyIndex.empty()) {
+			keyIndex.insert(keys.begin(), keys.begin() + keyCount);
+		}
+		keyIndex.insert(key);
+	}
+}
+
+void StreamParser::parse() {
+	StreamChunkParser(Element(pending, filename), *this).parse();
+	retrySize = pending.size() * 2;	// an incomplete step is parsed again from its beginning, so back off geometrically
+}
+
+void StreamParser::feed(const Char* begin, const Char* end) {
+	assert(!finished);
+	pending.append(begin, end);
+	if (pending.size() >= retrySize) {
+		parse();
+	}
+}
+
+void StreamParser::finish() {
+	assert(!finished);
+	finished = true;
+	parse();
+	assert(started && depth == 0 && pending.empty());
+}
+
+void parseStream(std::istream& input, StreamHandler& handler, const String& filename) {
+	StreamParser parser(handler, filename);
+	std::vector<Char> buffer(64 * 1024);
+	while (input) {
+		input.read(buffer.data(), buffer.size());
+		parser.feed(buffer.data(), buffer.data() + input.gcount());
+	}
+	parser.finish();
+}
+
+/*
+	Runs `task(i)` for every i below `count` on up to `threadCount` threads, including the calling one. Returns false if
+	any task returns false or throws (remaining tasks are then skipped). Each thread runs its tasks in one
+	RealConversionScope.
+*/
+template<typename T> class ParallelRun {
+	public:
+		ParallelRun(T& task, size_t count) : task(task), count(count), next(0), ok(true) { }
+		bool run(unsigned threadCount);
+
+	protected:
+		void work();
+		T& task;
+		const size_t count;
+		std::atomic<size_t> next;
+		std::atomic<bool> ok;
+};
+
+template<typename T> bool ParallelRun<T>::run(unsigned threadCount) {
+	std::vector<std::thread> threads;
+	try {
+		for (unsigned i = 1; i < threadCount && i < count; ++i) {
+			threads.push_back(std::thread(&ParallelRun::work, this));
+		}
+	}
+	catch (const std::system_error&) {	// could not start more threads, continue with those we have
+	}
+	work();
+	for (size_t i = 0; i < threads.size(); ++i) {
+		threads[i].join();
+	}
+	return ok;
+}
+
+template<typename T> void ParallelRun<T>::work() {
+	RealConversionScope realConversionScope;
+	try {
+		for (size_t i = next++; ok && i < count; i = next++) {
+			if (!task(i)) {
+				ok = false;
+			}
+		}
+	}
+	catch (...) {
+		ok = false;
+	}
+}
+
+static unsigned parallelThreadCount(unsigned threadCount) {
+	return (threadCount != 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1U));
+}
+
+/*
+	Splits and parses top-level lists for parseParallel(). Chunks begin where the serial parser begins a new member
+	(after a separator and white) and every chunk but the last must end with a separator. A chunk that parses without
+	error therefore gives exactly the members that the serial parser gives for it, and if all chunks parse, so does the
+	entire list. On a valid prefix the pre-scan sees the same strings and comments as the parser (quotes are never text
+	chars), so the chunk with the first error fails just like the serial parser does.
+*/
+class ParallelChunkParser : public Parser {
+	public:
+		typedef std::vector< std::pair<String, Element> > Members;
+		ParallelChunkParser(const Element& source) : Parser(source) { }
+		bool split(size_t chunkCount, std::vector<StringIt>& bounds);
+		template<typename S> bool parseChunk(S& elements, StringIt begin, StringIt end, bool last);
+		static bool mergeMembers(std::vector<Members>& chunks, Members& merged, unsigned threadCount);
+		static void assign(FlatStruct& to, Members& members) { to.members.swap(members); }
+		static bool keyOrder(const Members::value_type& a, const Members::value_type& b) { return a.first < b.first; }
+
+	protected:
+		bool member(Array& elements);
+		bool member(HashStruct& elements) { return keyValuePair(elements); }
+};
+
+/*
+	Scans the list like the StructuralIndex (but only counts braces) and puts the first member after the first top-level
+	separator past every `chunkCount`:th part of the source into `bounds`, plus the beginning and end of the list.
+	Returns false if the list can't be split (or surely is invalid).
+*/
+bool ParallelChunkParser::split(size_t chunkCount, std::vector<StringIt>& bounds) {
+	whiteAndComments();
+	const bool braced = (!eof() && *p == '{');
+	if (braced) {
+		++p;
+		whiteAndComments();
+	}
+	if (!eof() && *p == ':') {	// special empty struct syntax { : }
+		return false;
+	}
+	const size_t chunkSize = (e - p) / chunkCount + 1;
+	bounds.assign(1, p);
+	StringIt listEnd = e;
+	int depth = 0;
+	const Char* q = p;
+	while (listEnd == e && (q = (depth == 0 ? scanChars<StructuralChars>(q, e) : scanChars<BlockChars>(q, e))) != e) {
+		switch (*q) {
+			case '{': ++depth; ++q; break;
+			case '}': {
+				if (depth == 0) {
+					if (!braced) {
+						return false;
+					}
+					listEnd = q;
+				}
+				--depth;
+				++q;
+				break;
+			}
+			case '\"': case '\'': {
+				q = findEndQuote(q + 1, e, QuoteOrEscapeChars(*q));
+				if (q == e) {
+					return false;
+				}
+				++q;
+				break;
+			}
+			case '/': {
+				bool closed;
+				const Char* const end = skipComment(q, e, closed);
+				q = (end != q ? end : q + 1);
+				break;
+			}
+			case ',': case '\n': {
+				if (depth == 0 && static_cast<size_t>(q - bounds.back()) >= chunkSize) {
+					p = q;
+					nextElement();
+					if (!eof() && *p != '}') {
+						bounds.push_back(p);
+					}
+					q = p;
+				} else {
+					++q;
+				}
+				break;
+			}
+			default: ++q; break;
+		}
+	}
+	if (braced) {
+		if (listEnd == e) {
+			return false;
+		}
+		p = listEnd + 1;
+		whiteAndComments();
+		if (!eof()) {
+			return false;
+		}
+	}
+	bounds.push_back(listEnd);
+	return (bounds.size() > 2);
+}
+
+bool ParallelChunkParser::member(Array& elements) {
+	Element v(source, p, p);
+	if (!valueElement(v)) {
+		return false;
+	}
+	horizontalWhiteAndComments();
+	elements.push_back(v);
+	return true;
+}
+
+// Same as valueListElements() and keyValueElements() but for a chunk.
+template<typename S> bool ParallelChunkParser::parseChunk(S& elements, StringIt begin, StringIt end, bool last) {
+	p = begin;
+	e = end;
+	while (!eof()) {
+		if (*p == '}' || !member(elements)) {
+			return false;
+		}
+		const bool separator = (!eof() && (*p == '\r' || *p == '\n' || *p == ','));
+		if (!nextElement() || (eof() && !separator && !last)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// Merges pairs of adjacent sorted runs of `members` (one level of ParallelChunkParser::mergeMembers()).
+class ParallelMergeTask {
+	public:
+		ParallelMergeTask(ParallelChunkParser::Members& members, const std::vector<size_t>& runs, size_t width)
+				: members(members), runs(runs), width(width) { }
+		size_t count() const { return (runs.size() - 2 + width) / (width * 2); }
+		bool operator()(size_t i) {
+			const size_t first = i * width * 2;
+			std::inplace_merge(members.begin() + runs[first], members.begin() + runs[first + width]
+					, members.begin() + runs[std::min(first + width * 2, runs.size() - 1)], ParallelChunkParser::keyOrder);
+			return true;
+		}
+		ParallelChunkParser::Members& members;
+		const std::vector<size_t>& runs;
+		const size_t width;
+};
+
+// Merges members sorted per chunk into one sorted vector. Returns false on duplicate keys.
+bool ParallelChunkParser::mergeMembers(std::vector<Members>& chunks, Members& merged, unsigned threadCount) {
+	std::vector<size_t> runs(1, 0);
+	size_t total = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		total += chunks[i].size();
+		runs.push_back(total);
+	}
+	merged.clear();
+	merged.reserve(total);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		std::move(chunks[i].begin(), chunks[i].end(), std::back_inserter(merged));
+		Members().swap(chunks[i]);
+	}
+	for (size_t width = 1; width < chunks.size(); width *= 2) {
+		ParallelMergeTask task(merged, runs, width);
+		ParallelRun<ParallelMergeTask>(task, task.count()).run(threadCount);
+	}
+	for (size_t i = 1; i < merged.size(); ++i) {
+		if (!(merged[i - 1].first < merged[i].first)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+class ParallelArrayTask {
+	public:
+		ParallelArrayTask(const Element& source, const std::vector<StringIt>& bounds)
+				: source(source), bounds(bounds), chunks(bounds.size() - 1) { }
+		bool operator()(size_t i) {
+			return ParallelChunkParser(source).parseChunk(chunks[i], bounds[i], bounds[i + 1], i + 2 == bounds.size());
+		}
+		const Element& source;
+		const std::vector<StringIt>& bounds;
+		std::vector<Array> chunks;
+};
+
+class ParallelStructTask {
+	public:
+		ParallelStructTask(const Element& source, const std::vector<StringIt>& bounds)
+				: source(source), bounds(bounds), chunks(bounds.size() - 1) { }
+		bool operator()(size_t i);
+		const Element& source;
+		const std::vector<StringIt>& bounds;
+		std::vector<ParallelChunkParser::Members> chunks;
+};
+
+bool ParallelStructTask::operator()(size_t i) {
+	HashStruct members;
+	if (!ParallelChunkParser(source).parseChunk(members, bounds[i], bounds[i + 1], i + 2 == bounds.size())) {
+		return false;
+	}
+	chunks[i].assign(std::make_move_iterator(members.begin()), std::make_move_iterator(members.end()));
+	std::sort(chunks[i].begin(), chunks[i].end(), ParallelChunkParser::keyOrder);
+	return true;
+}
+
+// Splits the list of `source` for `threadCount` threads. False if it should be parsed serially.
+static bool splitParallel(const Element& source, unsigned threadCount, std::vector<StringIt>& bounds) {
+	if (!source.exists()) {
+		throw UndefinedElementError();
+	}
+	const size_t chunkCount = std::min(static_cast<size_t>(threadCount) * 4, source.code().size() / PARALLEL_CHUNK_SIZE);
+	return (threadCount > 1 && chunkCount >= 2 && ParallelChunkParser(source).split(chunkCount, bounds));
+}
+
+void parseParallel(const Element& source, Array& to, unsigned threadCount) {
+	threadCount = parallelThreadCount(threadCount);
+	std::vector<StringIt> bounds;
+	if (splitParallel(source, threadCount, bounds)) {
+		ParallelArrayTask task(source, bounds);
+		if (ParallelRun<ParallelArrayTask>(task, task.chunks.size()).run(threadCount)) {
+			size_t total = 0;
+			for (size_t i = 0; i < task.chunks.size(); ++i) {
+				total += task.chunks[i].size();
+			}
+			to.clear();
+			to.reserve(total);
+			for (size_t i = 0; i < task.chunks.size(); ++i) {
+				std::move(task.chunks[i].begin(), task.chunks[i].end(), std::back_inserter(to));
+			}
+			return;
+		}
+	}
+	Parser(source).parse(to);
+}
+
+static bool parseParallelMembers(const Element& source, unsigned threadCount, ParallelChunkParser::Members& members) {
+	std::vector<StringIt> bounds;
+	if (splitParallel(source, threadCount, bounds)) {
+		ParallelStructTask task(source, bounds);
+		return (ParallelRun<ParallelStructTask>(task, task.chunks.size()).run(threadCount)
+				&& ParallelChunkParser::mergeMembers(task.chunks, members, threadCount));
+	}
+	return false;
+}
+
+void parseParallel(const Element& source, Struct& to, unsigned threadCount) {
+	ParallelChunkParser::Members members;
+	if (parseParallelMembers(source, parallelThreadCount(threadCount), members)) {
+		Struct merged;
+		for (ParallelChunkParser::Members::iterator it = members.begin(); it != members.end(); ++it) {
+			merged.insert(merged.end(), std::move(*it));	// sorted, so a lot faster than the range constructor
+		}
+		to.swap(merged);
+	} else {
+		Parser(source).parse(to);
+	}
+}
+
+void parseParallel(const Element& source, FlatStruct& to, unsigned threadCount) {
+	ParallelChunkParser::Members members;
+	if (parseParallelMembers(source, parallelThreadCount(threadCount), members)) {
+		ParallelChunkParser::assign(to, members);
+	} else {
+		Parser(source).parse(to);
+	}
+}
+
+static WideChar widen(const Char c) { return static_cast<UChar>(c); }
+static WideChar widen(const WideChar c) { return c; }
+
+Variant::Type Document::Node::type() const {
+	return (exists() ? data->type : Variant::INVALID);
+}
+
+size_t Document::Node::size() const {
+	const Variant::Type t = type();
+	return (t == Variant::STRUCT || t == Variant::ARRAY ? data->count : 0);
+}
+
+Document::Node Document::Node::operator[](size_t i) const {
+	return (i < size() ? Node(document, data->children + i) : Node());
+}
+
+template<typename C> Document::Node Document::Node::find(const std::basic_string<C>& key) const {
+	if (type() != Variant::STRUCT) {
+		return Node();
+	}
+	const NodeData* low = data->children;
+	const NodeData* high = data->children + data->count;
+	while (low < high) {
+		const NodeData* const middle = low + (high - low) / 2;
+		const size_t n = std::min(middle->keyLength, key.size());
+		size_t i = 0;
+		while (i < n && middle->key[i] == widen(key[i])) {
+			++i;
+		}
+		if (i == n && middle->keyLength == key.size()) {
+			return Node(document, middle);
+		} else if (i < n ? middle->key[i] < widen(key[i]) : middle->keyLength < key.size()) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return Node();
+}
+
+Document::Node Document::Node::operator[](const String& key) const { return find(key); }
+Document::Node Document::Node::operator[](const WideString& key) const { return find(key); }
+
+WideString Document::Node::key() const {
+	return (exists() && data->keyLength != 0 ? WideString(data->key, data->keyLength) : WideString());
+}
+
+StringIt Document::Node::begin() const {
+	assert(exists());
+	return document->code.begin() + data->begin;
+}
+
+StringIt Document::Node::end() const {
+	assert(exists());
+	return document->code.begin() + data->end;
+}
+
+Element Document::Node::element() const {
+	return Element(document->code, begin(), end());
+}
+
+bool Document::Node::resolved(bool& v) const {
+	v = data->boolean;
+	return (data->type == Variant::BOOLEAN);
+}
+
+bool Document::Node::resolved(int64_t& v) const {
+	v = data->integer;
+	return (data->type == Variant::INTEGER);
+}
+
+bool Document::Node::resolved(uint64_t& v) const {
+	v = data->unsignedInteger;
+	// "-0" is a valid INTEGER, but not a valid unsigned
+	return (data->type == Variant::UNSIGNED_INTEGER || (data->type == Variant::INTEGER && data->integer >= 0
+			&& *begin() != '-'));
+}
+
+bool Document::Node::resolved(double& v) const {
+	v = data->real;
+	return (data->type == Variant::REAL);
+}
+
+// Values out of range are left to the parser, which reports them.
+template<typename T> bool Document::Node::resolvedSignedInt(T& v) const {
+	int64_t i;
+	if (!resolved(i) || i < std::numeric_limits<T>::min() || i > std::numeric_limits<T>::max()) {
+		return false;
+	}
+	v = static_cast<T>(i);
+	return true;
+}
+
+template<typename T> bool Document::Node::resolvedUnsignedInt(T& v) const {
+	uint64_t ui;
+	if (!resolved(ui) || ui > static_cast<uint64_t>(std::numeric_limits<T>::max())) {
+		return false;
+	}
+	v = static_cast<T>(ui);
+	return true;
+}
+
+bool Document::Node::resolved(int8_t& v) const { return resolvedSignedInt(v); }
+bool Document::Node::resolved(uint8_t& v) const { return resolvedUnsignedInt(v); }
+bool Document::Node::resolved(int16_t& v) const { return resolvedSignedInt(v); }
+bool Document::Node::resolved(uint16_t& v) const { return resolvedUnsignedInt(v); }
+bool Document::Node::resolved(int32_t& v) const { return resolvedSignedInt(v); }
+bool Document::Node::resolved(uint32_t& v) const { return resolvedUnsignedInt(v); }
+
+/*
+	Rounds the resolved double to the nearest float on the bits, so the floating point environment doesn't matter. This
+	gives the float that parsing the source gives, except when the double lies exactly halfway between two floats (the
+	source may be on either side) or when the float is not normal. Those are left to the parser.
+*/
+bool Document::Node::resolved(float& v) const {
+	if (data->type != Variant::REAL) {
+		return false;
+	}
+	uint64_t bits;
+	memcpy(&bits, &data->real, sizeof (bits));
+	const uint32_t HALF = 1U << 28;	// of the 29 significand bits that a float drops
+	const uint32_t sign = static_cast<uint32_t>(bits >> 32) & 0x80000000U;
+	const int exponent = static_cast<int>((bits >> 52) & 0x7FF) - 1023;
+	const uint32_t dropped = static_cast<uint32_t>(bits) & (HALF * 2 - 1);
+	uint32_t floatBits = sign;
+	if ((bits << 1) != 0) {
+		if (exponent < -126 || exponent > 127 || dropped == HALF) {
+			return false;
+		}
+		floatBits |= (static_cast<uint32_t>(exponent + 127) << 23) | (static_cast<uint32_t>(bits >> 29) & 0x7FFFFF);
+		floatBits += (dropped > HALF ? 1 : 0);	// a carry rounds up to the next exponent (or to infinity)
+	}
+	memcpy(&v, &floatBits, sizeof (v));
+	return true;
+}
+
+bool Document::Node::resolved(String& v) const {
+	if (data->type != Variant::TEXT) {
+		return false;
+	}
+	v.resize(data->count);
+	for (size_t i = 0; i < data->count; ++i) {
+		const WideChar c = data->text[i];
+		if (static_cast<uint32_t>(c) >= 0x100) {	// not iso-8859-1, let the parser report it
+			return false;
+		}
+		v[i] = rewrap<Char>(c);
+	}
+	return true;
+}
+
+bool Document::Node::resolved(WideString& v) const {
+	if (data->type != Variant::TEXT) {
+		return false;
+	}
+	v.assign(data->text, data->count);
+	return true;
+}
+
+template<typename T> bool Parser::tryToParseReal(T& r) {
+	whiteAndComments();
+	if (!real(r)) {
+		return false;
+	}
+	whiteAndComments();
+	return eof();
+}
+
+// Parses a real number at `p` (without surrounding white). False if there is none.
+template<typename T> bool Parser::real(T& r) {
+	if (eof()) {
+		return false;
+	}
+	const Char* const b = &*p;
+	const Char* const next = parseReal<T>(b, &*(e - 1) + 1, r);
+	p += next - b;
+	return (next != b);
+}
+
+bool Parser::tryToParse(double& d) { return tryToParseReal(d); }
+bool Parser::tryToParse(float& f) { return tryToParseReal(f); }
+
+/*
+	Classifies the number at `p` in a single forward scan and converts it once. The magnitude is accumulated while the
+	digits are scanned, and only if the element turns out not to be a plain integer is it converted again, as a real.
+	Returns INTEGER, UNSIGNED_INTEGER or REAL (with the value in `toInteger`, `toUnsignedInteger` or `toReal`), the same
+	as trying the int64_t, uint64_t and double parsers in turn would give, or INVALID if it is not a number (with `p`
+	anywhere).
+*/
+Variant::Type Parser::classifyNumber(int64_t& toInteger, uint64_t& toUnsignedInteger, double& toReal) {
+	const StringIt b = p;
+	const bool negative = (!eof() && *p == '-');
+	if (negative) {
+		++p;
+	}
+	uint64_t magnitude;
+	if ((!negative || eof() || *p != '+') && unsignedInt(magnitude)) {
+		whiteAndComments();
+		if (eof()) {
+			const uint64_t HALF_MAX = static_cast<uint64_t>(1) << 63;
+			if (magnitude < HALF_MAX) {
+				toInteger = (negative ? -static_cast<int64_t>(magnitude) : static_cast<int64_t>(magnitude));
+				return Variant::INTEGER;
+			}
+			if (negative && magnitude == HALF_MAX) {
+				toInteger = -static_cast<int64_t>(magnitude - 1) - 1;
+				return Variant::INTEGER;
+			}
+			if (!negative) {
+				toUnsignedInteger = magnitude;
+				return Variant::UNSIGNED_INTEGER;
+			}
+		}
+	}
+	p = b;
+	if (!real(toReal)) {
+		return Variant::INVALID;
+	}
+	whiteAndComments();
+	return (eof() ? Variant::REAL : Variant::INVALID);
+}
+
+template<typename T> bool Parser::number(T& n, std::true_type /* isReal */) {
+	return real(n);
+}
+
+template<typename T> bool Parser::number(T& n, std::false_type /* isReal */) {
+	return (std::is_signed<T>::value ? signedInt(n) : unsignedInt(n));
+}
+
+/*
+	Parses the element at `p` (and the white and comments after it) if it is just a number that the general path (a
+	Parser on the element) would parse the same. False otherwise, with `p` anywhere.
+*/
+template<typename T> bool Parser::plainNumber(T& n) {
+	if (!number(n, std::is_floating_point<T>())) {
+		return false;
+	}
+	horizontalWhiteAndComments();
+	return (eof() || !isTextChar(*p));	// else there is more text in the element
+}
+
+/*
+	Parses a '{ }' array of numbers in a single loop, converting each element straight from the source instead of
+	building an Array and running a new Parser on every element. It only accepts lists of plain numbers, where it gives
+	the same results as the general path. Anything else (quoted or nested elements, a number followed by more text,
+	syntax errors) makes parse() return false, and the caller redoes it all with the general path so that errors are
+	reported exactly as before.
+*/
+template<typename T> class NumberListParser : public Parser {
+	public:
+		NumberListParser(const Element& source) : Parser(source) { }
+		NumberListParser(const Parser& parser) : Parser(parser) { }
+		template<typename O> bool parse(O& output);	// calls output.push_back(T) for each element
+		void parseElements(std::vector<T>& output);	// restarts on the general path; throws where it fails
+};
+
+template<typename T> template<typename O> bool NumberListParser<T>::parse(O& output) {
+	whiteAndComments();
+	const bool braced = (!eof() && *p == '{');
+	if (braced) {
+		++p;
+		whiteAndComments();
+	}
+	while (!eof() && *p != '}') {
+		T n;
+		if (!plainNumber(n)) {
+			return false;
+		}
+		output.push_back(n);
+		if (!nextElement()) {
+			return false;
+		}
+	}
+	if (braced) {
+		if (eof() || *p != '}') {
+			return false;
+		}
+		++p;
+		whiteAndComments();
+	}
+	return eof();
+}
+
+template<typename T> void NumberListParser<T>::parseElements(std::vector<T>& output) {
+	p = source.begin();
+	if (!tryToParseElements(output)) {
+		throwError();
+	}
+}
+
+template<typename T> bool Parser::tryToParseNumbers(std::vector<T>& toVector) {
+	toVector.clear();
+	NumberListParser<T> numberListParser(*this);
+	if (numberListParser.parse(toVector)) {
+		p = numberListParser.getFailPoint();
+		return true;
+	}
+	return tryToParseElements(toVector);
+}
+
+bool Parser::tryToParse(std::vector<float>& v) { RealConversionScope scope; return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<double>& v) { RealConversionScope scope; return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<int8_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<uint8_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<int16_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<uint16_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<int32_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<uint32_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<int64_t>& v) { return tryToParseNumbers(v); }
+bool Parser::tryToParse(std::vector<uint64_t>& v) { return tryToParseNumbers(v); }
+
+// Returns false for the special empty struct syntax { : } (and leaves `p` at the closing brace).
+bool Parser::openFields(bool& braced) {
+	whiteAndComments();
+	braced = (!eof() && *p == '{');
+	if (braced) {
+		++p;
+		whiteAndComments();
+	}
+	if (!eof() && *p == ':') {
+		++p;
+		whiteAndComments();
+		return false;
+	}
+	return true;
+}
+
+// Parses the key and the ':' of a member, like keyValuePair().
+bool Parser::fieldKey(StringView& key) {
+	if (!parseKey(key)) {
+		return false;
+	}
+	horizontalWhiteAndComments();
+	if (eof() || *p != ':') {
+		return false;
+	}
+	++p;
+	horizontalWhiteAndComments();
+	return true;
+}
+
+// Fails at `keyBegin` like keyValuePair() does for duplicate keys, i.e. after scanning the value.
+bool Parser::skipFieldValue(StringIt keyBegin) {
+	StringIt end;
+	if (skipValue(end)) {
+		p = keyBegin;
+	}
+	return false;
+}
+
+bool Parser::closeFields(bool braced) {
+	if (braced) {
+		if (eof() || *p != '}') {
+			return false;
+		}
+		++p;
+		whiteAndComments();
+	}
+	return eof();
+}
+
+template<typename T> bool Parser::fieldNumber(T& to) {
+	const StringIt b = p;
+	if (plainNumber(to)) {
+		return true;
+	}
+	p = b;
+	return fieldValue<T>(to);
+}
+
+bool Parser::fieldValue(float& to) { return fieldNumber(to); }
+bool Parser::fieldValue(double& to) { return fieldNumber(to); }
+bool Parser::fieldValue(int8_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(uint8_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(int16_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(uint16_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(int32_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(uint32_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(int64_t& to) { return fieldNumber(to); }
+bool Parser::fieldValue(uint64_t& to) { return fieldNumber(to); }
+
+// Output for NumberListParser that fills a caller buffer and counts also the elements that did not fit.
+template<typename T> struct NumberBuffer {
+	NumberBuffer(T* to, size_t capacity) : to(to), capacity(capacity), count(0) { }
+	void push_back(T n) {
+		if (count < capacity) {
+			to[count] = n;
+		}
+		++count;
+	}
+	T* const to;
+	const size_t capacity;
+	size_t count;
+};
+
+template<typename T> static size_t parseNumbersInto(const Element& source, T* to, size_t capacity) {
+	if (!source.exists()) {
+		throw UndefinedElementError();
+	}
+	NumberBuffer<T> buffer(to, capacity);
+	NumberListParser<T> numberListParser(source);
+	if (numberListParser.parse(buffer)) {
+		return buffer.count;
+	}
+	std::vector<T> numbers;
+	numberListParser.parseElements(numbers);	// throws at the same point as always
+	std::copy(numbers.begin(), numbers.begin() + std::min(numbers.size(), capacity), to);
+	return numbers.size();
+}
+
+size_t parseNumbers(const Element& source, float* to, size_t capacity) {
+	RealConversionScope scope;
+	return parseNumbersInto(source, to, capacity);
+}
+
+size_t parseNumbers(const Element& source, double* to, size_t capacity) {
+	RealConversionScope scope;
+	return parseNumbersInto(source, to, capacity);
+}
+
+size_t parseNumbers(const Element& source, int8_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, uint8_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, int16_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, uint16_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, int32_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, uint32_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, int64_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+size_t parseNumbers(const Element& source, uint64_t* to, size_t capacity) { return parseNumbersInto(source, to, capacity); }
+
+bool Parser::isEmpty() {
+	whiteAndComments();
+	return eof();
+}
+
+static const char* const SCHEMA_TYPE_NAMES[] = { "any", "struct", "array", "text", "real", "integer", "boolean" };
+
+static SchemaError schemaError(const Element& source, StringIt at, const String& reason) {
+	const LineAndColumn lineAndColumn = source.lineAndColumn(at);
+	return SchemaError(source.filename(), source.offset(at), lineAndColumn.first, lineAndColumn.second, reason);
+}
+
+Schema::Node::Node() : type(ANY), optional(false), minimumInteger(std::numeric_limits<int64_t>::min())
+		, maximumInteger(std::numeric_limits<int64_t>::max()), minimumReal(-std::numeric_limits<double>::infinity())
+		, maximumReal(std::numeric_limits<double>::infinity()), minimumSize(0)
+		, maximumSize(std::numeric_limits<size_t>::max()), elements(NONE), otherMembers(NONE) { }
+
+Schema::Schema(const Element& schema) {
+	compile(schema);
+}
+
+/*
+	Compiles `schema` (and its nested schemas) and returns the index of its node. Options are checked against the type
+	so that misspelled or misplaced options are errors instead of being ignored.
+*/
+size_t Schema::compile(const Element& schema) {
+	Node node;
+	Struct options;
+	Element typeElement = schema;
+	String typeName;
+	if (!Parser(schema).tryToParse(typeName)) {
+		options = schema.to<Struct>();
+		const Struct::const_iterator it = options.find("type");
+		if (it == options.end()) {
+			throw schemaError(schema, schema.begin(), "missing schema type");
+		}
+		typeElement = it->second;
+		typeName = typeElement.to<String>();
+	}
+	const size_t typeCount = sizeof (SCHEMA_TYPE_NAMES) / sizeof (*SCHEMA_TYPE_NAMES);
+	const size_t type = std::find(SCHEMA_TYPE_NAMES, SCHEMA_TYPE_NAMES + typeCount, typeName) - SCHEMA_TYPE_NAMES;
+	if (type == typeCount) {
+		throw schemaError(typeElement, typeElement.begin(), "unknown schema type \"" + typeName + '\"');
+	}
+	node.type = static_cast<Type>(type);
+	const size_t index = nodes.size();
+	nodes.push_back(node);	// children follow their parent
+	for (Struct::const_iterator it = options.begin(); it != options.end(); ++it) {
+		const String& key = it->first;
+		const Element& value = it->second;
+		if (key == "type") {
+		} else if (key == "optional") {
+			node.optional = value.to<bool>();
+		} else if (node.type == INTEGER && key == "min") {
+			node.minimumInteger = value.to<int64_t>();
+		} else if (node.type == INTEGER && key == "max") {
+			node.maximumInteger = value.to<int64_t>();
+		} else if (node.type == REAL && key == "min") {
+			node.minimumReal = value.to<double>();
+		} else if (node.type == REAL && key == "max") {
+			node.maximumReal = value.to<double>();
+		} else if ((node.type == TEXT && key == "minLength") || (node.type == ARRAY && key == "minCount")) {
+			node.minimumSize = static_cast<size_t>(value.to<uint64_t>());
+		} else if ((node.type == TEXT && key == "maxLength") || (node.type == ARRAY && key == "maxCount")) {
+			node.maximumSize = static_cast<size_t>(value.to<uint64_t>());
+		} else if (node.type == TEXT && key == "values") {
+			node.values = value.to< std::vector<String> >();
+		} else if (node.type == ARRAY && key == "elements") {
+			node.elements = compile(value);
+		} else if (node.type == STRUCT && key == "members") {
+			const Struct members = value.to<Struct>();
+			for (Struct::const_iterator member = members.begin(); member != members.end(); ++member) {
+				node.members.push_back(std::make_pair(member->first, compile(member->second)));	// sorted like Struct
+			}
+		} else if (node.type == STRUCT && key == "otherMembers") {
+			node.otherMembers = compile(value);
+		} else {
+			throw schemaError(value, value.begin(), "unknown option \"" + key + "\" for " + typeName);
+		}
+	}
+	nodes[index] = node;
+	return index;
+}
+
+struct SchemaMemberOrder {
+	bool operator()(const std::pair<String, size_t>& member, const StringView& key) const {
+		return StringView(member.first) < key;
+	}
+};
+
+/*
+	Checks a source against the nodes of a Schema in a single pass. It follows tryToParseStruct(), tryToParse(Array&)
+	and the element parsers step by step, so syntax errors fail at the same points as with to<T>() and leave `reason`
+	empty. Schema mismatches set `reason`.
+*/
+class SchemaValidator : public Parser {
+	public:
+		SchemaValidator(const Schema& schema, const Element& source) : Parser(source), schema(schema) { }
+		bool validate() { return value(0, true); }
+		void throwError();
+		String reason;
+
+	protected:
+		bool value(size_t nodeIndex, bool root);
+		bool structure(const Schema::Node& node, bool root);
+		bool array(const Schema::Node& node, bool root);
+		template<typename T> bool leaf(T& to, bool root, const char* typeName);
+		template<typename T> bool numberValue(T& n, bool root, const char* typeName);
+		bool rejectKey(StringIt keyBegin, const String& why);
+		bool mismatch(StringIt at, const String& why);
+		const Schema& schema;
+		std::vector<char> seen;		// flags for the members of all open structs
+};
+
+void SchemaValidator::throwError() {
+	if (reason.empty()) {
+		Parser::throwError();
+	}
+	throw schemaError(source, p, reason);
+}
+
+bool SchemaValidator::mismatch(StringIt at, const String& why) {
+	p = at;
+	reason = why;
+	return false;
+}
+
+// Fails like duplicate keys do (see skipFieldValue()), with `why` unless the value has a syntax error.
+bool SchemaValidator::rejectKey(StringIt keyBegin, const String& why) {
+	skipFieldValue(keyBegin);
+	return (p == keyBegin ? mismatch(keyBegin, why) : false);
+}
+
+// Parses an element like to<T>() does (the entire source for `root`).
+template<typename T> bool SchemaValidator::leaf(T& to, bool root, const char* typeName) {
+	const StringIt b = p;
+	Element value = source;
+	if (!root && !valueElement(value)) {
+		return false;
+	}
+	if (!Parser(value).tryToParse(to)) {
+		return mismatch(b, String("expected ") + typeName);
+	}
+	if (root) {
+		p = e;
+	}
+	return true;
+}
+
+template<typename T> bool SchemaValidator::numberValue(T& n, bool root, const char* typeName) {
+	const StringIt b = p;
+	if (!root && plainNumber(n)) {
+		return true;
+	}
+	p = b;
+	return leaf(n, root, typeName);
+}
+
+bool SchemaValidator::value(size_t nodeIndex, bool root) {
+	const StringIt b = p;
+	const Schema::Type type = (nodeIndex == Schema::NONE ? Schema::ANY : schema.nodes[nodeIndex].type);
+	switch (type) {
+		case Schema::ANY: {
+			if (root) {
+				p = e;
+				return true;
+			}
+			StringIt end;
+			return skipValue(end);
+		}
+		case Schema::STRUCT: return structure(schema.nodes[nodeIndex], root);
+		case Schema::ARRAY: return array(schema.nodes[nodeIndex], root);
+		case Schema::TEXT: {
+			const Schema::Node& node = schema.nodes[nodeIndex];
+			StringView text;
+			if (!leaf(text, root, "text")) {
+				return false;
+			}
+			if (text.size() < node.minimumSize) {
+				return mismatch(b, "text is shorter than " + compose(static_cast<uint64_t>(node.minimumSize)));
+			}
+			if (text.size() > node.maximumSize) {
+				return mismatch(b, "text is longer than " + compose(static_cast<uint64_t>(node.maximumSize)));
+			}
+			if (!node.values.empty() && std::find_if(node.values.begin(), node.values.end()
+					, [&text](const String& value) { return StringView(value) == text; }) == node.values.end()) {
+				return mismatch(b, "text is not one of the allowed values");
+			}
+			return true;
+		}
+		case Schema::REAL: {
+			const Schema::Node& node = schema.nodes[nodeIndex];
+			double real;
+			if (!numberValue(real, root, "real")) {
+				return false;
+			}
+			if (real < node.minimumReal) {
+				return mismatch(b, "real is less than " + compose(node.minimumReal));
+			}
+			if (real > node.maximumReal) {
+				return mismatch(b, "real is greater than " + compose(node.maximumReal));
+			}
+			return true;
+		}
+		case Schema::INTEGER: {
+			const Schema::Node& node = schema.nodes[nodeIndex];
+			int64_t integer;
+			if (!numberValue(integer, root, "integer")) {
+				return false;
+			}
+			if (integer < node.minimumInteger) {
+				return mismatch(b, "integer is less than " + compose(node.minimumInteger));
+			}
+			if (integer > node.maximumInteger) {
+				return mismatch(b, "integer is greater than " + compose(node.maximumInteger));
+			}
+			return true;
+		}
+		case Schema::BOOLEAN: {
+			bool boolean;
+			return leaf(boolean, root, "boolean");
+		}
+	}
+	assert(0);
+	return false;
+}
+
+bool SchemaValidator::structure(const Schema::Node& node, bool root) {
+	if (!root && (eof() || *p != '{')) {
+		return mismatch(p, "expected struct");
+	}
+	bool braced;
+	const bool hasMembers = openFields(braced);
+	const size_t base = seen.size();
+	seen.resize(base + node.members.size(), 0);
+	std::set<StringView> otherKeys;
+	while (hasMembers && !eof() && *p != '}') {
+		const StringIt keyBegin = p;
+		StringView key;
+		if (!fieldKey(key)) {
+			return false;
+		}
+		const std::vector< std::pair<String, size_t> >::const_iterator it = std::lower_bound(node.members.begin()
+				, node.members.end(), key, SchemaMemberOrder());
+		size_t memberNode = node.otherMembers;
+		if (it != node.members.end() && StringView(it->first) == key) {
+			char& isSeen = seen[base + (it - node.members.begin())];
+			if (isSeen) {
+				return rejectKey(keyBegin, "duplicate key");
+			}
+			isSeen = 1;
+			memberNode = it->second;
+		} else if (node.otherMembers == Schema::NONE) {
+			return rejectKey(keyBegin, "unknown key \"" + key.str() + '\"');
+		} else if (!otherKeys.insert(key).second) {
+			return rejectKey(keyBegin, "duplicate key");
+		}
+		if (!value(memberNode, false)) {
+			return false;
+		}
+		horizontalWhiteAndComments();
+		if (!nextElement()) {
+			return false;
+		}
+	}
+	if (braced && (eof() || *p != '}')) {
+		return false;
+	}
+	for (size_t i = 0; i < node.members.size(); ++i) {
+		if (!seen[base + i] && !schema.nodes[node.members[i].second].optional) {
+			return mismatch(p, "missing key \"" + node.members[i].first + '\"');
+		}
+	}
+	seen.resize(base);
+	if (root) {
+		return closeFields(braced);
+	}
+	++p;
+	return true;
+}
+
+bool SchemaValidator::array(const Schema::Node& node, bool root) {
+	if (root) {
+		whiteAndComments();
+	} else if (eof() || *p != '{') {
+		return mismatch(p, "expected array");
+	}
+	const bool braced = (!eof() && *p == '{');
+	if (braced) {
+		++p;
+		whiteAndComments();
+	}
+	size_t count = 0;
+	while (!eof() && *p != '}') {
+		if (count == node.maximumSize) {
+			return mismatch(p, "more than " + compose(static_cast<uint64_t>(count)) + " elements");
+		}
+		if (!value(node.elements, false)) {
+			return false;
+		}
+		++count;
+		horizontalWhiteAndComments();
+		if (!nextElement()) {
+			return false;
+		}
+	}
+	if (braced && (eof() || *p != '}')) {
+		return false;
+	}
+	if (count < node.minimumSize) {
+		return mismatch(p, "fewer than " + compose(static_cast<uint64_t>(node.minimumSize)) + " elements");
+	}
+	if (braced) {
+		++p;
+		if (!root) {
+			return true;
+		}
+		whiteAndComments();
+	}
+	return eof();
+}
+
+void Schema::validate(const Element& source) const {
+	if (!source.exists()) {
+		throw UndefinedElementError();
+	}
+	SchemaValidator validator(*this, source);
+	if (!validator.validate()) {
+		validator.throwError();
+	}
+}
+
+bool Schema::tryToValidate(const Element& source, size_t& failOffset) const {
+	if (!source.exists()) {
+		throw UndefinedElementError();
+	}
+	SchemaValidator validator(*this, source);
+	if (!validator.validate()) {
+		failOffset = validator.getFailPoint() - source.begin();
+		return false;
+	}
+	return true;
+}
+
+/*
+	Appends [b, e) with the indentation of its last line removed from every line and `tabCount` tabs added after every
+	newline, in a single forward pass straight into `to` (only the last line is read twice).
+*/
+static void appendReindented(String& to, StringIt b, StringIt e, size_t tabCount) {
+	StringIt lastLine = e;
+	while (lastLine != b && lastLine[-1] != '\n') {
+		--lastLine;
+	}
+	size_t dropCount = 0;
+	while (lastLine + dropCount != e && lastLine[dropCount] == '\t') {
+		++dropCount;
+	}
+	StringIt p = b;
+	while (true) {
+		for (size_t i = 0; p != e && *p == '\t' && i < dropCount; ++i) {
+			++p;
+		}
+		const StringIt newLine = static_cast<StringIt>(memchr(p, '\n', e - p));
+		if (newLine == 0) {
+			to.append(p, e);
+			break;
+		}
+		to.append(p, newLine + 1);
+		p = newLine + 1;
+		if (p == e) {
+			break;
+		}
+		to.append(tabCount, '\t');
+	}
+}
+
+String compose(const Char* fromString, bool preferUnquoted) {
+	return quoteString(String(fromString), preferUnquoted, '\"');
+}
+
+String compose(const String& fromString, bool preferUnquoted) {
+	return quoteString(fromString, preferUnquoted, '\"');
+}
+
+String compose(const WideChar* fromString, bool preferUnquoted) {
+	return quoteString(WideString(fromString), preferUnquoted, '\"');
+}
+
+String compose(const WideString& fromString, bool preferUnquoted) {
+	return quoteString(fromString, preferUnquoted, '\"');
+}
+
+// Appends one element as compose(const Array&) does (shared with composeParallel()).
+static void composeArrayElement(String& string, const Element& element, bool lastElement, bool multiLine, bool bracket) {
+	if (!element.exists()) {
+		throw UndefinedElementError();
+	}
+	if (multiLine && bracket) {
+		string += '\t';
+	}
+	appendReindented(string, element.begin(), element.end(), multiLine && bracket ? 1 : 0);
+	if (!lastElement || Parser(element).isEmpty()) {
+		string += ',';
+	}
+	if (!lastElement || multiLine || bracket) {
+		string += (multiLine ? '\n' : ' ');
+	}
+}
+
+String compose(const Array& array, bool multiLine, bool bracket) {
+	String string = (bracket ? (multiLine ? "{\n" : "{ ") : "");
+	for (Array::const_iterator it = array.begin(); it != array.end(); ++it) {
+		composeArrayElement(string, *it, it + 1 == array.end(), multiLine, bracket);
+	}
+	return string + (bracket ? "}" : "");
+}
+
+static const String& toCharString(const String& s) { return s; }
+static String toCharString(const WideString& s) { return String(s.begin(), s.end()); }
+
+// Appends one member as composeStruct() does (shared with composeParallel()). `first` is for the first member only.
+template<typename I> static void composeStructMember(String& string, const I& it, bool first, bool multiLine
+		, bool bracket) {
+	if (it->second.exists()) {
+		if (!first) {
+			string += (multiLine ? (bracket ? "\n\t" : "\n") : ", ");
+		}
+		string += (keyNeedsQuoting(it->first)
+				? quoteString(it->first, false, '\"') : toCharString(it->first));
+		string += ": ";
+		appendReindented(string, it->second.begin(), it->second.end(), multiLine && bracket ? 1 : 0);
+	}
+}
+
+template<typename S> String composeStruct(const S& structure, bool multiLine, bool bracket) {
+	String string = (bracket ? (multiLine ? "{\n\t" : "{ ") : "");
+	for (typename S::const_iterator it = structure.begin(); it != structure.end(); ++it) {
+		composeStructMember(string, it, it == structure.begin(), multiLine, bracket);
+	}
+	if (structure.begin() == structure.end()) {
+		string += ':';
+	}
+	return string + (multiLine ? (bracket ? "\n}" : "\n") : (bracket ? " }" : ""));
+}
+
+String compose(const Struct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+FieldComposer::FieldComposer(String& string, bool multiLine, bool bracket)
+	: string(string), multiLine(multiLine), bracket(bracket), first(true) {
+	string = (bracket ? (multiLine ? "{\n\t" : "{ ") : "");
+}
+
+// Same as composeStructMember().
+void FieldComposer::field(const char* key, const String& code) {
+	if (!first) {
+		string += (multiLine ? (bracket ? "\n\t" : "\n") : ", ");
+	}
+	first = false;
+	string += key;
+	string += ": ";
+	appendReindented(string, code.data(), code.data() + code.size(), multiLine && bracket ? 1 : 0);
+}
+
+// Same as the end of composeStruct().
+void FieldComposer::finish() {
+	if (first) {
+		string += ':';
+	}
+	string += (multiLine ? (bracket ? "\n}" : "\n") : (bracket ? " }" : ""));
+}
+
+String compose(const WideStruct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+String compose(const FlatStruct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+String compose(const WideFlatStruct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+String compose(const HashStruct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+String compose(const WideHashStruct& structure, bool multiLine, bool bracket) {
+	return composeStruct(structure, multiLine, bracket);
+}
+
+static const size_t PARALLEL_COMPOSE_MINIMUM = 1024;	// elements per chunk
+
+/*
+	Composes the chunks of elements or members that begin at `starts` (with an extra end iterator last) for
+	composeParallel(). Each chunk gets its own String with exactly the text that the serial composer appends for it.
+*/
+template<typename C> class ParallelComposeTask {
+	public:
+		typedef typename C::const_iterator const_iterator;
+		ParallelComposeTask(const C& container, bool multiLine, bool bracket, unsigned threadCount);
+		bool operator()(size_t i);
+		String join(const String& prefix, const String& suffix) const;
+		const C& container;
+		const bool multiLine;
+		const bool bracket;
+		std::vector<const_iterator> starts;
+		std::vector<String> chunks;
+
+	protected:
+		void composeChunk(const Array&, String& string, const_iterator b, const_iterator e) const;
+		template<typename S> void composeChunk(const S&, String& string, const_iterator b, const_iterator e) const;
+};
+
+template<typename C> ParallelComposeTask<C>::ParallelComposeTask(const C& container, bool multiLine, bool bracket
+		, unsigned threadCount) : container(container), multiLine(multiLine), bracket(bracket) {
+	const size_t chunkCount = std::max(std::min(static_cast<size_t>(threadCount) * 4
+			, container.size() / PARALLEL_COMPOSE_MINIMUM), static_cast<size_t>(1));
+	const size_t chunkSize = (container.size() + chunkCount - 1) / chunkCount;
+	const_iterator it = container.begin();
+	for (size_t i = 0; i < container.size(); ++i, ++it) {
+		if (i % chunkSize == 0) {
+			starts.push_back(it);
+		}
+	}
+	starts.push_back(container.end());
+	chunks.resize(starts.size() - 1);
+}
+
+template<typename C> bool ParallelComposeTask<C>::operator()(size_t i) {
+	composeChunk(container, chunks[i], starts[i], starts[i + 1]);
+	return true;
+}
+
+template<typename C> void ParallelComposeTask<C>::composeChunk(const Array&, String& string, const_iterator b
+		, const_iterator e) const {
+	for (const_iterator it = b; it != e; ++it) {
+		composeArrayElement(string, *it, it + 1 == container.end(), multiLine, bracket);
+	}
+}
+
+template<typename C> template<typename S> void ParallelComposeTask<C>::composeChunk(const S&, String& string
+		, const_iterator b, const_iterator e) const {
+	for (const_iterator it = b; it != e; ++it) {
+		composeStructMember(string, it, it == container.begin(), multiLine, bracket);
+	}
+}
+
+template<typename C> String ParallelComposeTask<C>::join(const String& prefix, const String& suffix) const {
+	size_t size = prefix.size() + suffix.size();
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		size += chunks[i].size();
+	}
+	String string;
+	string.reserve(size);
+	string += prefix;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		string += chunks[i];
+	}
+	string += suffix;
+	assert(string.size() == size);
+	return string;
+}
+
+String composeParallel(const Array& array, bool multiLine, bool bracket, unsigned threadCount) {
+	threadCount = parallelThreadCount(threadCount);
+	if (threadCount < 2 || array.size() < PARALLEL_COMPOSE_MINIMUM * 2) {
+		return compose(array, multiLine, bracket);
+	}
+	ParallelComposeTask<Array> task(array, multiLine, bracket, threadCount);
+	if (!ParallelRun< ParallelComposeTask<Array> >(task, task.chunks.size()).run(threadCount)) {
+		return compose(array, multiLine, bracket);	// throws the same exception (e.g. UndefinedElementError) serially
+	}
+	return task.join((bracket ? (multiLine ? "{\n" : "{ ") : ""), (bracket ? "}" : ""));
+}
+
+template<typename S> static String composeStructParallel(const S& structure, bool multiLine, bool bracket
+		, unsigned threadCount) {
+	threadCount = parallelThreadCount(threadCount);
+	if (threadCount < 2 || structure.size() < PARALLEL_COMPOSE_MINIMUM * 2) {
+		return composeStruct(structure, multiLine, bracket);
+	}
+	ParallelComposeTask<S> task(structure, multiLine, bracket, threadCount);
+	if (!ParallelRun< ParallelComposeTask<S> >(task, task.chunks.size()).run(threadCount)) {
+		return composeStruct(structure, multiLine, bracket);
+	}
+	return task.join((bracket ? (multiLine ? "{\n\t" : "{ ") : "")
+			, (multiLine ? (bracket ? "\n}" : "\n") : (bracket ? " }" : "")));
+}
+
+String composeParallel(const Struct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+String composeParallel(const WideStruct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+String composeParallel(const FlatStruct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+String composeParallel(const WideFlatStruct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+String composeParallel(const HashStruct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+String composeParallel(const WideHashStruct& structure, bool multiLine, bool bracket, unsigned threadCount) {
+	return composeStructParallel(structure, multiLine, bracket, threadCount);
+}
+
+void OStreamSink::write(const Char* begin, const Char* end) {
+	stream.write(begin, end - begin);
+}
+
+void FileSink::write(const Char* begin, const Char* end) {
+	fwrite(begin, sizeof (Char), end - begin, file);
+}
+
+void BufferSink::write(const Char* begin, const Char* end) {
+	const size_t n = end - begin;
+	if (count < capacity) {
+		std::copy(begin, begin + std::min(n, capacity - count), buffer + count);
+	}
+	count += n;
+}
+
+Composer::Composer(ComposeSink& sink, bool multiLine) : sink(sink), multiLine(multiLine) {
+	buffer.reserve(BUFFER_SIZE);
+}
+
+Composer::~Composer() {
+	try {
+		flush();
+	}
+	catch (...) {
+	}
+}
+
+void Composer::flush() {
+	if (!buffer.empty()) {
+		sink.write(buffer.data(), buffer.data() + buffer.size());
+		buffer.clear();
+	}
+}
+
+void Composer::append(const Char* begin, const Char* end) {
+	if (buffer.size() + (end - begin) > BUFFER_SIZE) {
+		flush();
+		if (end - begin >= BUFFER_SIZE) {
+			sink.write(begin, end);
+			return;
+		}
+	}
+	buffer.append(begin, end);
+}
+
+void Composer::appendTabs(size_t count) {
+	if (buffer.size() + count > BUFFER_SIZE) {
+		flush();
+	}
+	buffer.append(count, '\t');
+}
+
+void Composer::appendKey(const String& key) {
+	if (keyNeedsQuoting(key)) {
+		const String quoted = quoteString(key, false, '\"');
+		append(quoted.data(), quoted.data() + quoted.size());
+	} else {
+		append(key.data(), key.data() + key.size());
+	}
+}
+
+// Writes what goes before a value in an array (separator and indentation). In a struct, key() has done that.
+void Composer::beginValue(bool isEmpty) {
+	if (!levels.empty()) {
+		Level& level = levels.back();
+		if (level.isStruct) {
+			assert(level.keyed);
+			level.keyed = false;
+		} else {
+			if (level.count > 0) {
+				append(multiLine ? ",\n" : ", ");
+			}
+			if (multiLine) {
+				appendTabs(levels.size());
+			}
+			level.lastEmpty = isEmpty;
+			++level.count;
+		}
+	}
+}
+
+Composer& Composer::beginStruct() {
+	beginValue(false);
+	const Level level = { true, false, 0, false };
+	levels.push_back(level);
+	append(multiLine ? "{\n" : "{ ");
+	if (multiLine) {
+		appendTabs(levels.size());
+	}
+	return *this;
+}
+
+Composer& Composer::endStruct() {
+	assert(!levels.empty() && levels.back().isStruct && !levels.back().keyed);
+	if (levels.back().count == 0) {
+		append(":");
 	}
-	const Char* const b = &*p;
-	const Char* e = parseReal<T>(b, &*(source.end() - 1) + 1, r);
-	if (e == b) {
-		return false;
+	if (multiLine) {
+		append("\n");
+		appendTabs(levels.size() - 1);
+		append("}");
+	} else {
+		append(" }");
 	}
-	p = source.begin() + (e - &*source.begin());
-	whiteAndComments();
-	return eof();
+	levels.pop_back();
+	return *this;
 }
 
-bool Parser::tryToParse(double& d) { return tryToParseReal(d); }
-bool Parser::tryToParse(float& f) { return tryToParseReal(f); }
-
-bool Parser::isEmpty() {
-	whiteAndComments();
-	return eof();
+Composer& Composer::beginArray() {
+	beginValue(false);
+	const Level level = { false, false, 0, false };
+	levels.push_back(level);
+	append(multiLine ? "{\n" : "{ ");
+	return *this;
 }
 
-static String reindent(const String& s, int tabCount) {
-	const StringIt b = s.begin();
-	const StringIt e = s.end();
-	StringIt p = e;
-	while (p != b && p[-1] != '\n') {
-		--p;
+Composer& Composer::endArray() {
+	assert(!levels.empty() && !levels.back().isStruct);
+	if (levels.back().count > 0) {
+		append(levels.back().lastEmpty ? "," : "");
+		append(multiLine ? "\n" : " ");
 	}
-	int dropCount = 0;
-	while (p != e && *p == '\t') {
-		++dropCount;
-		++p;
+	if (multiLine) {
+		appendTabs(levels.size() - 1);
 	}
-	String indented;
-	p = b;
-	while (p != e) {
-		int i = 0;
-		while (p != e && *p == '\t' && i < dropCount) {
-			++p;
-			++i;
-		}
-		const StringIt q = p;
-		while (p != e && *p != '\n') {
-			++p;
+	append("}");
+	levels.pop_back();
+	return *this;
+}
+
+Composer& Composer::key(const String& key) {
+	assert(!levels.empty() && levels.back().isStruct && !levels.back().keyed);
+	Level& level = levels.back();
+	if (level.count > 0) {
+		if (multiLine) {
+			append("\n");
+			appendTabs(levels.size());
+		} else {
+			append(", ");
 		}
-		if (p != e) {
-			++p;
+	}
+	appendKey(key);
+	append(": ");
+	level.keyed = true;
+	++level.count;
+	return *this;
+}
+
+Composer& Composer::key(const WideString& key) {
+	return this->key(keyNeedsQuoting(key) ? quoteString(key, false, '\"') : toCharString(key));
+}
+
+// Writes [begin, end) like compose() writes the code of a member, i.e. reindented for the current depth.
+Composer& Composer::code(StringIt begin, StringIt end, bool isEmpty) {
+	beginValue(isEmpty);
+	if (levels.empty()) {
+		append(begin, end);
+	} else {
+		if (buffer.size() + (end - begin) > BUFFER_SIZE) {
+			flush();
 		}
-		indented.insert(indented.end(), q, p);
-		if (p != e) {
-			for (int i = 0; i < tabCount; ++i) {
-				indented += '\t';
-			}
+		appendReindented(buffer, begin, end, multiLine ? levels.size() : 0);	// only a single huge code exceeds BUFFER_SIZE
+		if (buffer.size() >= BUFFER_SIZE) {
+			flush();
 		}
 	}
-	return indented;
+	return *this;
 }
 
-String compose(const Char* fromString, bool preferUnquoted) {
-	return quoteString(String(fromString), preferUnquoted, '\"');
+Composer& Composer::value(const Element& element) {
+	if (!element.exists()) {
+		throw UndefinedElementError();
+	}
+	return code(element.begin(), element.end(), Parser(element).isEmpty());
 }
 
-String compose(const String& fromString, bool preferUnquoted) {
-	return quoteString(fromString, preferUnquoted, '\"');
+Composer& Composer::value(double value) {
+	Char chars[32];
+	beginValue(false);
+	append(chars, realToString<double>(chars, value));
+	return *this;
 }
 
-String compose(const WideChar* fromString, bool preferUnquoted) {
-	return quoteString(WideString(fromString), preferUnquoted, '\"');
+Composer& Composer::value(float value) {
+	Char chars[32];
+	beginValue(false);
+	append(chars, realToString<float>(chars, value));
+	return *this;
 }
 
-String compose(const WideString& fromString, bool preferUnquoted) {
-	return quoteString(fromString, preferUnquoted, '\"');
+Composer& Composer::value(int value) {
+	Char chars[sizeof (int) * 8 + 1];
+	beginValue(false);
+	append(intToString(chars, value, 10, 1), chars + sizeof (chars));
+	return *this;
 }
 
-String compose(const Array& array, bool multiLine, bool bracket) {
+String compose(float fromFloat) { return floatToString(fromFloat); }
+String compose(double fromDouble) { return doubleToString(fromDouble); }
+
+static Char* numberToChars(Char* destination, float value) { return realToString<float>(destination, value); }
+static Char* numberToChars(Char* destination, double value) { return realToString<double>(destination, value); }
+
+template<typename T> static Char* numberToChars(Char* destination, T value) {
+	Char buffer[sizeof (T) * 8 + 1];
+	const Char* const b = decimalToString(buffer + sizeof (buffer), value);
+	return std::copy(b, static_cast<const Char*>(buffer + sizeof (buffer)), destination);
+}
+
+/*
+	compose() for vectors of numbers. Writes each number with its separators straight into the output, exactly like
+	compose(const Array&) would, but without a String and an Element per number (and the Parser that decides on the
+	comma after the last element, which is never needed for a number).
+*/
+template<typename T> static String composeNumbers(const std::vector<T>& numbers, bool multiLine, bool bracket) {
 	String string = (bracket ? (multiLine ? "{\n" : "{ ") : "");
-	for (Array::const_iterator it = array.begin(); it != array.end(); ++it) {
-		if (multiLine && bracket) {
-			string += '\t';
+	const bool indent = (multiLine && bracket);
+	const Char separator = (multiLine ? '\n' : ' ');
+	for (typename std::vector<T>::const_iterator it = numbers.begin(); it != numbers.end(); ++it) {
+		Char chars[40];
+		Char* p = chars;
+		if (indent) {
+			*p++ = '\t';
 		}
-		const String code = it->code();
-		string += reindent(code, multiLine && bracket ? 1 : 0);
-		const bool lastElement = (it + 1 == array.end());
-		if (!lastElement || Parser(code).isEmpty()) {
-			string += ',';
+		p = numberToChars(p, *it);
+		const bool lastElement = (it + 1 == numbers.end());
+		if (!lastElement) {
+			*p++ = ',';
 		}
 		if (!lastElement || multiLine || bracket) {
-			string += (multiLine ? '\n' : ' ');
+			*p++ = separator;
 		}
+		assert(p <= chars + sizeof (chars));
+		string.append(chars, p);
 	}
 	return string + (bracket ? "}" : "");
 }
 
-static const String& toCharString(const String& s) { return s; }
-static String toCharString(const WideString& s) { return String(s.begin(), s.end()); }
+String compose(const std::vector<float>& vector, bool multiLine, bool bracket) {
+	RealConversionScope scope;
+	return composeNumbers(vector, multiLine, bracket);
+}
 
-template<typename S> String composeStruct(const S& structure, bool multiLine, bool bracket) {
-	String string = (bracket ? (multiLine ? "{\n\t" : "{ ") : "");
-	for (typename S::const_iterator it = structure.begin(); it != structure.end(); ++it) {
-		if (it->second.exists()) {
-			if (it != structure.begin()) {
-				string += (multiLine ? (bracket ? "\n\t" : "\n") : ", ");
-			}
-			string += (keyNeedsQuoting(it->first)
-					? quoteString(it->first, false, '\"') : toCharString(it->first));
-			string += ": ";
-			string += reindent(it->second.code(), multiLine && bracket ? 1 : 0);
-		}
-	}
-	if (structure.begin() == structure.end()) {
-		string += ':';
-	}
-	return string + (multiLine ? (bracket ? "\n}" : "\n") : (bracket ? " }" : ""));
+String compose(const std::vector<double>& vector, bool multiLine, bool bracket) {
+	RealConversionScope scope;
+	return composeNumbers(vector, multiLine, bracket);
 }
 
-String compose(const Struct& structure, bool multiLine, bool bracket) {
-	return composeStruct(structure, multiLine, bracket);
+String compose(const std::vector<int8_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
 }
 
-String compose(const WideStruct& structure, bool multiLine, bool bracket) {
-	return composeStruct(structure, multiLine, bracket);
+String compose(const std::vector<uint8_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
 }
 
-String compose(float fromFloat) { return floatToString(fromFloat); }
-String compose(double fromDouble) { return doubleToString(fromDouble); }
+String compose(const std::vector<int16_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
+
+String compose(const std::vector<uint16_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
+
+String compose(const std::vector<int32_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
+
+String compose(const std::vector<uint32_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
+
+String compose(const std::vector<int64_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
+
+String compose(const std::vector<uint64_t>& vector, bool multiLine, bool bracket) {
+	return composeNumbers(vector, multiLine, bracket);
+}
 
 template<typename T> String composeSignedInt(const T i, const bool hexFormat, int minHexLength) {
 	if (hexFormat) {
@@ -1433,15 +5145,15 @@ String compose(bool fromBool) {
 }
 
 String compose(const Variant& variant) {
-	switch (variant.type) {
-		default: assert(0);
-		case Variant::STRUCT: return compose(variant.structure);
-		case Variant::ARRAY: return compose(variant.array);
-		case Variant::TEXT: return compose(variant.text);
-		case Variant::REAL: return compose(variant.real);
-		case Variant::INTEGER: return compose(variant.integer);
-		case Variant::UNSIGNED_INTEGER: return compose(variant.unsignedInteger, true);
-		case Variant::BOOLEAN: return compose(variant.boolean);
+	switch (variant.type()) {
+		case Variant::STRUCT: return compose(variant.structure());
+		case Variant::ARRAY: return compose(variant.array());
+		case Variant::TEXT: return compose(variant.text());
+		case Variant::REAL: return compose(variant.real());
+		case Variant::INTEGER: return compose(variant.integer());
+		case Variant::UNSIGNED_INTEGER: return compose(variant.unsignedInteger(), true);
+		case Variant::BOOLEAN: return compose(variant.boolean());
+		default: assert(0); return compose(WideStruct());
 	}
 }
 
@@ -1469,10 +5181,10 @@ template<typename T> T stringToReal(const String& s, size_t* nextOffset) {
 
 template<typename T> std::basic_string<T> unescapeGeneric(const String& s, size_t* nextOffset) {
 	std::basic_string<T> unescaped;
-	StringIt p = s.begin();
-	const StringIt e = s.end();
+	StringIt p = s.data();
+	const StringIt e = s.data() + s.size();
 	p = skipWhite(p, e);
-	if (p != s.end() && (*p == '\"' || *p == '\'')) {
+	if (p != e && (*p == '\"' || *p == '\'')) {
 		genericUnquoteString(p, e, unescaped);
 		p = skipWhite(p, e);
 	} else if (!s.empty()) {
@@ -1482,7 +5194,7 @@ template<typename T> std::basic_string<T> unescapeGeneric(const String& s, size_
 		p = e;
 	}
 	if (nextOffset != 0) {
-		*nextOffset = p - s.begin();
+		*nextOffset = p - s.data();
 	}
 	return unescaped;
 }
@@ -1591,6 +5303,58 @@ const char* UndefinedNamedElementError::what() const throw() {
 	}
 }
 
+} // namespace Numbstrict
+
+// Structs bound for unitTest() (NUMBSTRICT_FIELDS must be used at global scope).
+struct NumbstrictTestPoint {
+	NumbstrictTestPoint() : x(0.0), y(0.0) { }
+	double x;
+	double y;
+	Numbstrict::String label;
+};
+NUMBSTRICT_FIELDS(NumbstrictTestPoint, x, y, label)
+
+struct NumbstrictTestShape {
+	NumbstrictTestShape() : visible(true), alpha(255) { }
+	Numbstrict::String name;
+	NumbstrictTestPoint origin;
+	std::vector<NumbstrictTestPoint> points;
+	bool visible;
+	uint8_t alpha;
+};
+NUMBSTRICT_FIELDS(NumbstrictTestShape, name, origin, points, visible, alpha)
+
+struct NumbstrictTestKeys { static constexpr const Numbstrict::Char* keys() { return " red,green, blue "; } };
+struct NumbstrictTestManyKeys {	// as many long keys as KeySet takes, to keep an eye on its compile time
+	static constexpr const Numbstrict::Char* keys() {
+		return
+			"someRatherLongFieldName00, someRatherLongFieldName01, someRatherLongFieldName02, "
+			"someRatherLongFieldName03, someRatherLongFieldName04, someRatherLongFieldName05, "
+			"someRatherLongFieldName06, someRatherLongFieldName07, someRatherLongFieldName08, "
+			"someRatherLongFieldName09, someRatherLongFieldName10, someRatherLongFieldName11, "
+			"someRatherLongFieldName12, someRatherLongFieldName13, someRatherLongFieldName14, "
+			"someRatherLongFieldName15, someRatherLongFieldName16, someRatherLongFieldName17, "
+			"someRatherLongFieldName18, someRatherLongFieldName19, someRatherLongFieldName20, "
+			"someRatherLongFieldName21, someRatherLongFieldName22, someRatherLongFieldName23, "
+			"someRatherLongFieldName24, someRatherLongFieldName25, someRatherLongFieldName26, "
+			"someRatherLongFieldName27, someRatherLongFieldName28, someRatherLongFieldName29, "
+			"someRatherLongFieldName30, someRatherLongFieldName31, someRatherLongFieldName32, "
+			"someRatherLongFieldName33, someRatherLongFieldName34, someRatherLongFieldName35, "
+			"someRatherLongFieldName36, someRatherLongFieldName37, someRatherLongFieldName38, "
+			"someRatherLongFieldName39, someRatherLongFieldName40, someRatherLongFieldName41, "
+			"someRatherLongFieldName42, someRatherLongFieldName43, someRatherLongFieldName44, "
+			"someRatherLongFieldName45, someRatherLongFieldName46, someRatherLongFieldName47, "
+			"someRatherLongFieldName48, someRatherLongFieldName49, someRatherLongFieldName50, "
+			"someRatherLongFieldName51, someRatherLongFieldName52, someRatherLongFieldName53, "
+			"someRatherLongFieldName54, someRatherLongFieldName55, someRatherLongFieldName56, "
+			"someRatherLongFieldName57, someRatherLongFieldName58, someRatherLongFieldName59, "
+			"someRatherLongFieldName60, someRatherLongFieldName61, someRatherLongFieldName62, "
+			"someRatherLongFieldName63";
+	}
+};
+
+namespace Numbstrict {
+
 bool unitTest() {
 #if !defined(NDEBUG)
 	std::u16string emoji16;
@@ -1613,12 +5377,19 @@ bool unitTest() {
 	assert(parser32.quotedString(emoji32));
 	assert(emoji32.size() == 1 && emoji32[0] == 0x1F419);
 
-	assert(reindent("asdf", 1) == "asdf");
-	assert(reindent("\t\t\tasdf", 1) == "asdf");
-	assert(reindent("{\n\t\t\t}", 0) == "{\n}");
-	assert(reindent("{\n\t\t\tasdf", 1) == "{\n\tasdf");
-	assert(reindent("{\n\t\t\t\t1\n\t\t\t\t2\n\t\t\t}", 0) == "{\n\t1\n\t2\n}");
-	assert(reindent("{\n\t\t\t\t1\n\t\t\t\t2\n\t\t\t}", 1) == "{\n\t\t1\n\t\t2\n\t}");
+	struct Reindent {
+		static String apply(const String& s, int tabCount) {
+			String indented;
+			appendReindented(indented, s.data(), s.data() + s.size(), tabCount);
+			return indented;
+		}
+	};
+	assert(Reindent::apply("asdf", 1) == "asdf");
+	assert(Reindent::apply("\t\t\tasdf", 1) == "asdf");
+	assert(Reindent::apply("{\n\t\t\t}", 0) == "{\n}");
+	assert(Reindent::apply("{\n\t\t\tasdf", 1) == "{\n\tasdf");
+	assert(Reindent::apply("{\n\t\t\t\t1\n\t\t\t\t2\n\t\t\t}", 0) == "{\n\t1\n\t2\n}");
+	assert(Reindent::apply("{\n\t\t\t\t1\n\t\t\t\t2\n\t\t\t}", 1) == "{\n\t\t1\n\t\t2\n\t}");
 
     assert((rewrap<int8_t, uint32_t>(13) == 13));
     assert((rewrap<int8_t, uint32_t>(4294967285) == -11));
@@ -1753,6 +5524,85 @@ bool unitTest() {
 	assert(floatToString(std::numeric_limits<float>::quiet_NaN()) == "nan");
 	assert(isNaN(stringToFloat("nan")));
 
+	{
+		// exactRealToString() must give exactly what the digit loop gives (or leave the decision to it).
+		uint64_t random = 0x0123456789abcdefULL;
+		int exactCount = 0;
+		for (int i = 0; i < 20000; ++i) {
+			random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+			double d;
+			memcpy(&d, &random, sizeof (d));
+			const float f = static_cast<float>(static_cast<int64_t>(random >> 40) - (1 << 23)) / (1 << (i % 24));
+			const double values[3] = { d, static_cast<double>(static_cast<int64_t>(random >> 44)) / 1000.0, f };
+			for (int j = 0; j < 3; ++j) {
+				Char exact[32];
+				Char digitLoop[32];
+				Char* e = exactRealToString(exact, values[j]);
+				exactCount += (e != 0 ? 1 : 0);
+				assert(e == 0 || String(exact, e) == String(digitLoop, digitLoopRealToString(digitLoop, values[j])));
+			}
+			Char exact[32];
+			Char digitLoop[32];
+			Char* e = exactRealToString(exact, f);
+			assert(e == 0 || String(exact, e) == String(digitLoop, digitLoopRealToString(digitLoop, f)));
+		}
+		assert(exactCount > 58000);
+#if NUMBSTRICT_SSE2
+		// Subnormals keep their sign and exponent with denormals-are-zero and flush-to-zero set.
+		const unsigned int csr = _mm_getcsr();
+		_mm_setcsr(csr | 0x8040);
+		const String subnormalFloat = floatToString(-1e-40f);
+		const String subnormalDouble = doubleToString(-2.5e-310);
+		_mm_setcsr(csr);
+		assert(subnormalFloat == "-1.0e-40" && subnormalDouble == "-2.5e-310");
+#endif
+	}
+	{
+		// exactDecimalToReal() must give exactly what the digit loop gives (or leave the decision to it).
+		uint64_t random = 0xfedcba9876543210ULL;
+		int exactCount = 0;
+		for (int i = 0; i < 20000; ++i) {
+			Char digits[24];
+			const int count = 1 + i % 19;
+			for (int j = 0; j < count; ++j) {
+				random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+				digits[j] = static_cast<Char>('1' + (random >> 33) % 9);
+			}
+			const int exponent = static_cast<int>((random >> 40) % 600) - 299;
+			double d;
+			float f;
+			if (exactDecimalToReal(digits, digits + count, exponent, d)) {
+				++exactCount;
+				assert(d == digitLoopDecimalToReal(digits, digits + count, exponent, 1.0));
+			}
+			if (exponent >= -45 && exponent <= 38 && exactDecimalToReal(digits, digits + count, exponent, f)) {
+				assert(f == digitLoopDecimalToReal(digits, digits + count, exponent, 1.0f));
+			}
+		}
+		assert(exactCount > 19000);
+	}
+	{
+		// Conversions inside a RealConversionScope give the standard results even when the caller rounds differently.
+		const String longDigits = "0.1000000000000000055511151231257827021181583404541015625";
+		const double expected = stringToDouble(longDigits);
+		const double third = 1.0 / 3.0;
+		const String expectedText = doubleToString(third);
+		const int previousRounding = fegetround();
+		fesetround(FE_UPWARD);
+		{
+			RealConversionScope scope;
+			{
+				RealConversionScope nested;
+				assert(stringToDouble(longDigits) == expected);
+			}
+			assert(stringToDouble(longDigits) == expected);
+			assert(doubleToString(third) == expectedText);
+			assert(fegetround() == FE_TONEAREST);
+		}
+		assert(fegetround() == FE_UPWARD);
+		fesetround(previousRounding);
+	}
+
 	assert(compose(false) == "false");
 	assert(compose(true) == "true");
 	assert(compose(0) == "0");
@@ -1927,6 +5777,613 @@ bool unitTest() {
 		assert(!Parser(Element("+1234x")).tryToParse(i32, failOffset) && failOffset == 5);
 	}
 	
+	for (int i = 0; i < 80; ++i) {	// stop chars at every offset relative to (SIMD) blocks
+		const String white = String(i, ' ') + "\t\r\n" + String(i % 37, '\t');
+		Parser whiteParser(Element(white + "x" + white));
+		assert(whiteParser.whiteAndComments() && whiteParser.p - whiteParser.source.begin() == static_cast<int>(white.size()));
+		Parser horizontalParser(Element(String(i, ' ') + "\n"));
+		assert(horizontalParser.horizontalWhiteAndComments() == (i > 0) && *horizontalParser.p == '\n');
+		const String text = String(i, 'x') + "\xE4\t* /" + String(i % 41, '/') + "y";	// no comment delimiters
+		assert(Element("/*" + text + "/*" + text + "*/" + text + "*/ abc //" + text).to<String>() == "abc");
+		assert(Element("/*" + text + "*/ abc /**/").to<String>() == "abc");
+		size_t failOffset = 0;
+		String s;
+		assert(!Parser(Element("/*" + text + "\x01 */")).tryToParse(s, failOffset) && failOffset == text.size() + 2);
+		assert(!Parser(Element("//" + text + "\x1f")).tryToParse(s, failOffset) && failOffset == text.size() + 2);
+		assert(Parser(Element("/*/*" + text + "/*" + text + "*/ x")).tryToParse(s) && s.empty());	// unterminated
+		assert(Parser(Element("//" + text + "\r abc")).tryToParse(s) && s == "abc");
+	}
+
+	{
+		const String code = "{ a: { 'x}': /* } */ { 1, \"}\" } }, b: 2 // }\n, c: 'z' }";
+		const Element plain(code);
+		const Element indexed(code);
+		indexed.indexStructure();
+		const StructuralIndex& index = *indexed.structuralIndex();
+		assert(index.partner(index.find(0)) == index.find(code.size() - 1) && index.offset(index.size() - 1) == code.size() - 1);
+		assert(index.find(code.find("} */")) == StructuralIndex::NONE && index.find(code.find("}\"")) == StructuralIndex::NONE);
+		assert(index.find(code.find(':')) != StructuralIndex::NONE && index.find(code.find(' ')) == StructuralIndex::NONE);
+		const size_t quote = index.find(code.find('\''));
+		assert(index.offset(index.partner(quote)) == code.find('\'', code.find('\'') + 1));
+		assert(compose(indexed.to<Struct>()) == compose(plain.to<Struct>()));
+		assert(indexed.to<Struct>()["a"].to<Struct>()["x}"].code() == "{ 1, \"}\" }");
+		assert(indexed.to<Struct>()["a"].to<Struct>()["x}"].to<Array>().size() == 2);
+		const Element inner(indexed, indexed.begin() + code.find("{ 1"), indexed.begin() + code.find(" }, b"));
+		assert(inner.to<Array>().size() == 2 && inner.to<Array>()[1].to<String>() == "}");
+		size_t failOffset = 0;
+		Array array;
+		const size_t closingQuote = code.find("\" }");	// parser sees an opening quote here, so the index is not used
+		assert(!Parser(Element(indexed, indexed.begin() + closingQuote, indexed.end())).tryToParse(array, failOffset));
+		assert(failOffset == code.size() - closingQuote);
+		Element unterminated("{ a: { 1, '}' ");
+		unterminated.indexStructure();
+		Struct structure;
+		assert(!Parser(unterminated).tryToParse(structure, failOffset) && failOffset == 14);
+		Element cut(unterminated, unterminated.begin() + 5, unterminated.begin() + 12);	// ends inside the quoted string
+		assert(!Parser(cut).tryToParse(array, failOffset) && failOffset == 7);
+		const Element shared(code);
+		std::vector<std::thread> threads;
+		std::vector<const StructuralIndex*> indexes(4);
+		for (size_t i = 0; i < indexes.size(); ++i) {
+			threads.push_back(std::thread([&shared, &indexes, i]() {
+				const Element copy(shared, shared.begin(), shared.end());
+				copy.indexStructure();
+				indexes[i] = copy.structuralIndex();
+			}));
+		}
+		for (size_t i = 0; i < threads.size(); ++i) {
+			threads[i].join();
+		}
+		assert(std::count(indexes.begin(), indexes.end(), shared.structuralIndex()) == 4);
+	}
+
+	{
+		struct Recorder : public StreamHandler {
+			String events;
+			virtual void beginStruct() { events += "{:"; }
+			virtual void endStruct() { events += '}'; }
+			virtual void beginArray() { events += '{'; }
+			virtual void endArray() { events += '}'; }
+			virtual void key(const WideString& key) { events += String(key.begin(), key.end()) + '='; }
+			virtual void scalar(const Element& value) { events += '(' + value.code() + ')'; }
+		};
+		const String source("{ a: 'x\\ty', \"b c\": { 1, /* } */ { : } }, d: { e: 2.5 } // }\n f: }  /* end");
+		Recorder whole;
+		StreamParser wholeParser(whole);
+		wholeParser.feed(source);
+		wholeParser.finish();
+		assert(whole.events == "{:a=('x\\ty')b c={(1){:}}d={:e=(2.5)}f=()}");
+		Recorder single;
+		StreamParser singleParser(single);
+		for (size_t i = 0; i < source.size(); ++i) {
+			singleParser.feed(source.data() + i, source.data() + i + 1);
+			assert(single.events.size() <= whole.events.size());
+		}
+		singleParser.finish();
+		assert(single.events == whole.events);
+		const char* const scalars[] = { "  'x\\ty' // z", "1 2", "" };
+		for (size_t i = 0; i < sizeof (scalars) / sizeof (*scalars); ++i) {
+			Recorder recorder;
+			StreamParser parser(recorder);
+			parser.feed(scalars[i]);
+			assert(recorder.events.empty());
+			parser.finish();
+			assert(recorder.events == '(' + String(scalars[i]).substr(scalars[i][0] == ' ' ? 2 : 0) + ')');
+		}
+		const char* const sources[] = { "{ a: 1, }", "{ 1, }", "{ :, }", "{ a: 1,, b: 2 }", "{ 1,, 2 }", "{ a: 1 b: 2 }"
+				, "{ a: 1,\n a: { } }", "{ a: { 1 },\n a: { } }", "{ a: '\\u0100' }", "{ a: '\\x4' }", "{ 'a\\q': 1 }"
+				, "{ { 1 } } x", "{ a: 1 /* }", "{ a: 1 } /* ", "{ a: b: 1 }", "{ 'a' \n : 1 }", "\n\n { 1 \x01 }"
+				, "a: 1", "a: 1 }", "a: 1\n a: 2", " : ", ": x", "a: { 1 }\nb: { c: 2 }" };
+		for (size_t i = 0; i < sizeof (sources) / sizeof (*sources); ++i) {
+			const Element element(sources[i]);
+			Document document;
+			size_t failOffset = 0;
+			const bool ok = Parser(element).tryToParse(document, failOffset);
+			Recorder recorder;
+			StreamParser parser(recorder);
+			try {
+				for (const Char* p = sources[i]; *p != 0; ++p) {
+					parser.feed(p, p + 1);
+				}
+				parser.finish();
+				assert(ok);
+			}
+			catch (const ParsingError& error) {
+				assert(!ok && error.getOffset() == failOffset);
+				assert(error.getLineNumber() == element.lineAndColumn(element.begin() + failOffset).first);
+				assert(error.getColumnNumber() == element.lineAndColumn(element.begin() + failOffset).second);
+			}
+		}
+		const char* const lists[] = { "a: 1", " // x\n a: 1\n'b c': { 2 }, d: 'x' /* */ ", "a: 1 }", "a: 1 b: 2"
+				, "a: 1\n a: { }", "a: { 1 }\n a: 2", "a: 1,, b: 2", ": ", " : /**/ ", ":, ", ": a: 1", "'a\\q': 1" };
+		for (size_t i = 0; i < sizeof (lists) / sizeof (*lists); ++i) {
+			const Element element(lists[i]);
+			Struct structure;
+			size_t failOffset = 0;
+			const bool ok = Parser(element).tryToParse(structure, failOffset);
+			Recorder recorder;
+			StreamParser parser(recorder);
+			try {
+				for (const Char* p = lists[i]; *p != 0; ++p) {
+					parser.feed(p, p + 1);
+				}
+				parser.finish();
+				assert(ok && recorder.events.substr(0, 2) == "{:" && *recorder.events.rbegin() == '}');
+			}
+			catch (const ParsingError& error) {
+				assert(!ok && error.getOffset() == failOffset);
+			}
+		}
+		Recorder list;
+		StreamParser listParser(list);
+		listParser.feed("a: 1\nb: 2");
+		assert(listParser.getDepth() == 1);
+		listParser.finish();
+		assert(list.events == "{:a=(1)b=(2)}");
+		String wide("{");
+		for (int i = 0; i < 20; ++i) {
+			wide += " k" + intToString(i) + ": { }\n";
+		}
+		Recorder recorder;
+		StreamParser wideParser(recorder);
+		wideParser.feed(wide + "}");
+		wideParser.finish();
+		try {
+			StreamParser(recorder).feed(wide + " k17: 1 }");
+			assert(0);
+		}
+		catch (const ParsingError& error) {
+			assert(error.getOffset() == wide.size() + 1);
+		}
+		std::istringstream input(source);
+		recorder.events.clear();
+		parseStream(input, recorder);
+		assert(recorder.events == whole.events);
+	}
+
+	{
+		const String code = "{ name: triangle, points: { { x: 0, y: 0 }, { x: 1.5, label: \"top right\" }\n"
+				"{ y: -2 /* below */, x: 16 } }\n  alpha: 0x80 }";
+		const NumbstrictTestShape shape = Element(code).to<NumbstrictTestShape>();
+		assert(shape.name == "triangle" && shape.visible && shape.alpha == 128 && shape.origin.x == 0.0);
+		assert(shape.points.size() == 3 && shape.points[1].x == 1.5 && shape.points[1].label == "top right");
+		assert(shape.points[2].x == 16.0 && shape.points[2].y == -2.0 && shape.points[2].label.empty());
+		const String composed = compose(shape);
+		assert(composed == "{ name: \"triangle\", origin: { x: 0.0, y: 0.0, label: \"\" }, points: { { x: 0.0, y: 0.0"
+				", label: \"\" }, { x: 1.5, y: 0.0, label: \"top right\" }, { x: 16.0, y: -2.0, label: \"\" } }, visible: true"
+				", alpha: 128 }");
+		assert(compose(Element(composed).to<NumbstrictTestShape>()) == composed);
+		assert(compose(Element(compose(shape, true)).to<NumbstrictTestShape>(), true) == compose(shape, true));
+		assert(compose(shape.points[1], true, false) == "x: 1.5\ny: 0.0\nlabel: \"top right\"\n");
+		assert(compose(shape.origin, true) == "{\n\tx: 0.0\n\ty: 0.0\n\tlabel: \"\"\n}");
+		assert(Element("{ : }").to<NumbstrictTestPoint>().label.empty());
+
+		// Errors fail at the first invalid point in the source. Unknown keys fail like duplicate keys, at the key.
+		const char* sources[] = { "{ x: 1, x: 2 }", "{ x: 1, y: }", "{ x: 1 y: 2 }", "{ x: 1, z: 2 }", "{ x: \"1\" }"
+				, "{ x: 1, y: 2 } }", "{ x: 1, label: \"a }", "{ x: 1e }", "{ x: { 1 } }", "{ 'x': 1, \"x\": 2 }" };
+		const size_t offsets[] = { 8, 11, 7, 8, 5, 15, 19, 6, 5, 10 };
+		for (size_t i = 0; i < sizeof (sources) / sizeof (*sources); ++i) {
+			try {
+				Element(sources[i]).to<NumbstrictTestPoint>();
+				assert(0);
+			}
+			catch (const ParsingError& error) {
+				assert(error.getOffset() == offsets[i]);
+			}
+		}
+		size_t failOffset = 0;
+		NumbstrictTestPoint point;
+		assert(!Parser(Element("{ y: 2, x: 1, x: 3 }")).tryToParse(point, failOffset) && failOffset == 14);
+		assert(point.x == 1.0 && point.y == 2.0);
+		NumbstrictTestShape parsed;
+		assert(!Parser(Element("{ origin: { x: 1, z: 2 } }")).tryToParse(parsed, failOffset) && failOffset == 18);
+		assert(!Parser(Element("{ name: \"a\" b, alpha: 1 }")).tryToParse(parsed, failOffset) && failOffset == 12);
+		assert(!Parser(Element("{ origin: { x: 1 } }, }")).tryToParse(parsed, failOffset) && failOffset == 20);
+		assert(parsed.origin.x == 1.0 && parsed.name == "a");
+	}
+
+	{
+		typedef KeySet<NumbstrictTestKeys> Keys;
+		assert(Keys::COUNT == 3 && Keys::find("red") == 0 && Keys::find("green") == 1 && Keys::find("blue") == 2);
+		assert(Keys::find("") < 0 && Keys::find("re") < 0 && Keys::find("reds") < 0 && Keys::find("red,") < 0);
+		assert(Keys::find(String("blue\0", 5)) < 0 && Keys::find("red,green") < 0 && Keys::find("Red") < 0);
+		typedef KeySet<NumbstrictTestManyKeys> ManyKeys;
+		assert(ManyKeys::COUNT == 64 && ManyKeys::find("someRatherLongFieldName64") < 0);
+		for (int i = 0; i < ManyKeys::COUNT; ++i) {
+			const Char digits[] = { static_cast<Char>('0' + i / 10), static_cast<Char>('0' + i % 10), 0 };
+			assert(ManyKeys::find(String("someRatherLongFieldName") + digits) == i);
+		}
+
+		const KeySlots<NumbstrictTestKeys> slots
+				= Element("{ blue: { 1, 2 }, 'red': 3 }").to< KeySlots<NumbstrictTestKeys> >();
+		assert(slots[0].to<int>() == 3 && !slots[1].exists() && slots[2].to< std::vector<int> >().size() == 2);
+		assert(!Element("{ : }").to< KeySlots<NumbstrictTestKeys> >()[0].exists());
+
+		// Unknown keys fail like duplicate keys in a Struct, i.e. at the key once the value has been scanned.
+		const char* sources[] = { "{ red: 1, blue: 2, red: 3 }", "{ red: 1, pink: 2 }", "{ red: 1, red: 2 }"
+				, "{ red: 1, pink: \"a }", "{ red: 1, red: \"a }", "red: 1\npink: 2" };
+		const size_t offsets[] = { 19, 10, 10, 20, 19, 7 };
+		for (size_t i = 0; i < sizeof (sources) / sizeof (*sources); ++i) {
+			size_t failOffset = 0;
+			KeySlots<NumbstrictTestKeys> parsed;
+			assert(!Parser(Element(sources[i])).tryToParse(parsed, failOffset) && failOffset == offsets[i]);
+			if (strstr(sources[i], "pink") == 0) {
+				Struct parsedStruct;
+				assert(!Parser(Element(sources[i])).tryToParse(parsedStruct, failOffset) && failOffset == offsets[i]);
+			}
+		}
+	}
+
+	{
+		const Schema schema(Element("{ type: struct, members: {\n"
+				"\tname: text\n"
+				"\tsize: { type: integer, min: 1, max: 100 }\n"
+				"\tratio: { type: real, min: 0, max: 1, optional: true }\n"
+				"\tmode: { type: text, values: { fast, exact } }\n"
+				"\ttags: { type: array, elements: text, maxCount: 2, optional: true }\n"
+				"\tdefines: { type: struct, otherMembers: text, optional: true }\n"
+				"} }"));
+		schema.validate(Element("name: a, size: 5, mode: fast"));
+		schema.validate(Element("{ name: a, size: 0x10, mode: 'exact', ratio: 1, tags: { x, y }\n"
+				"defines: { A: 1, B: b } }"));
+
+		// Syntax errors fail like to<Struct>(). Mismatches fail at the value, the key or the closing brace.
+		const char* sources[] = { "name: a, size: 0, mode: fast", "name: a, size: 5.5, mode: fast"
+				, "name: a, size: 5, mode: slow", "name: a, size: 5", "name: a, size: 5, mode: fast, tags: { a, b, c }"
+				, "name: a, size: 5, mode: fast, other: 1", "name: a, size: 5, mode: fast, name: b"
+				, "name: a, size: 5, mode: fast, defines: { A: 1, A: 2 }", "name: { }, size: 5, mode: fast"
+				, "name: a, size: 5, mode: fast, ratio: 2", "name: a, size: 5, mode: fast, tags: x"
+				, "name: a, size: 5, mode: \"fast", "{ name: a, size: 5, mode: fast"
+				, "{ name: a, size: 5, mode: fast } x" };
+		const size_t offsets[] = { 15, 15, 24, 16, 44, 30, 30, 47, 6, 37, 36, 29, 30, 33 };
+		const size_t syntaxErrors = 3;	// the last ones
+		const size_t count = sizeof (sources) / sizeof (*sources);
+		for (size_t i = 0; i < count; ++i) {
+			size_t failOffset = 0;
+			assert(!schema.tryToValidate(Element(sources[i]), failOffset) && failOffset == offsets[i]);
+			try {
+				schema.validate(Element(sources[i]));
+				assert(0);
+			}
+			catch (const SchemaError& error) {
+				assert(i < count - syntaxErrors && error.getOffset() == offsets[i] && !error.getReason().empty());
+			}
+			catch (const ParsingError& error) {
+				assert(i >= count - syntaxErrors && error.getOffset() == offsets[i]);
+				try {
+					Element(sources[i]).to<Struct>();
+					assert(0);
+				}
+				catch (const ParsingError& structError) {
+					assert(structError.getOffset() == error.getOffset());
+				}
+			}
+		}
+
+		Schema(Element("{ type: array, elements: integer }")).validate(Element("1, 2\n3"));
+		Schema(Element("integer")).validate(Element(" 12 "));
+		Schema(Element("any")).validate(Element("{ x"));
+		size_t failOffset = 0;
+		assert(!Schema(Element("{ type: array, minCount: 4 }")).tryToValidate(Element("{ 1, { 2 } }"), failOffset)
+				&& failOffset == 11);
+		const char* invalidSchemas[] = { "{ type: integer, minLength: 2 }", "{ type: number }", "{ min: 2 }"
+				, "{ type: struct, members: { x: { type: real, max: a } } }" };
+		const size_t schemaOffsets[] = { 28, 8, 0, 49 };
+		for (size_t i = 0; i < sizeof (invalidSchemas) / sizeof (*invalidSchemas); ++i) {
+			try {
+				Schema invalid((Element(invalidSchemas[i])));
+				assert(0);
+			}
+			catch (const ParsingError& error) {
+				assert(error.getOffset() == schemaOffsets[i]);
+			}
+		}
+	}
+
+	{
+		// compose() of vectors of numbers must give exactly what composing an Array of the composed numbers gives.
+		std::vector<int64_t> ints;
+		ints.push_back(std::numeric_limits<int64_t>::min());
+		ints.push_back(-100);
+		ints.push_back(0);
+		ints.push_back(99);
+		ints.push_back(std::numeric_limits<int64_t>::max());
+		std::vector<double> reals;
+		reals.push_back(-0.0);
+		reals.push_back(1e-300);
+		reals.push_back(std::numeric_limits<double>::infinity());
+		reals.push_back(0.1);
+		Array intElements;
+		Array realElements;
+		for (size_t i = 0; i < ints.size(); ++i) {
+			intElements.push_back(Element(compose(ints[i])));
+		}
+		for (size_t i = 0; i < reals.size(); ++i) {
+			realElements.push_back(Element(compose(reals[i])));
+		}
+		for (int flags = 0; flags < 4; ++flags) {
+			const bool multiLine = ((flags & 1) != 0);
+			const bool bracket = ((flags & 2) != 0);
+			assert(compose(ints, multiLine, bracket) == compose(intElements, multiLine, bracket));
+			assert(compose(reals, multiLine, bracket) == compose(realElements, multiLine, bracket));
+			assert(compose(std::vector<uint8_t>(), multiLine, bracket) == compose(Array(), multiLine, bracket));
+		}
+		assert(compose(ints) == "{ -9223372036854775808, -100, 0, 99, 9223372036854775807 }");
+		assert(compose(std::vector<uint8_t>(1, 255), true) == "{\n\t255\n}");
+		assert(compose(std::numeric_limits<int8_t>::min()) == "-128" && compose(static_cast<uint16_t>(10)) == "10");
+	}
+
+	{
+		// Vectors of numbers take NumberListParser; it must agree with the general path, also on where it fails.
+		struct Outcome {
+			static String of(const Element& element, bool general) {
+				std::vector<int32_t> numbers;
+				Parser parser(element);
+				try {
+					const bool ok = (general ? parser.tryToParseElements(numbers) : parser.tryToParse(numbers));
+					if (!ok) {
+						return "false at " + intToString(static_cast<int>(parser.getFailPoint() - element.begin()));
+					}
+				}
+				catch (const ParsingError& error) {
+					return "error at " + intToString(static_cast<int>(error.getOffset()));
+				}
+				String result;
+				for (size_t i = 0; i < numbers.size(); ++i) {
+					result += compose(numbers[i]) + ";";
+				}
+				return result;
+			}
+		};
+		const char* sources[] = { "{ }", "{ 1, -2, 0x10 }", "1, 2\n3", "{ 1 // one\n 2 /* two */, 3 }", "{ 1,, 2 }"
+				, "{ 1, 2", "{ 1, 2 } 3", "{ 1 2 }", "{ 1x, 2 }", "{ 01 }", "{ 2147483648 }", "{ \"1\" }", "{ { 1 } }"
+				, "{ 1, /* 2 }", "{ -, 1 }", "{ 1 }}", "{ a: 1 }" };
+		for (size_t i = 0; i < sizeof (sources) / sizeof (*sources); ++i) {
+			const Element element(sources[i]);
+			assert(Outcome::of(element, false) == Outcome::of(element, true));
+		}
+		assert(Outcome::of(Element("{ 1 // one\n 2 /* two */, 3 }"), false) == "1;2;3;");
+		const std::vector<double> reals = Element("{ 0.1, -2.5e3, inf\n 1.0000000000000000000000001 }")
+				.to< std::vector<double> >();
+		assert(reals.size() == 4 && reals[0] == 0.1 && reals[1] == -2500.0 && reals[3] == 1.0);
+		assert(reals[2] == std::numeric_limits<double>::infinity());
+		float floats[2] = { 0.0f, 0.0f };
+		assert(parseNumbers(Element("{ 1.5, 2.5, 3.5 }"), floats, 2) == 3 && floats[0] == 1.5f && floats[1] == 2.5f);
+		assert(parseNumbers(Element("{ }"), floats, 0) == 0);
+		uint8_t bytes[4];
+		assert(parseNumbers(Element("{ 1, 255 }"), bytes, 4) == 2 && bytes[0] == 1 && bytes[1] == 255);
+		try {
+			parseNumbers(Element("{ 1, 2\n 3x }"), bytes, 4);
+			assert(0);
+		}
+		catch (const ParsingError& error) {
+			assert(error.getOffset() == 9 && error.getLineNumber() == 2 && error.getColumnNumber() == 3);
+		}
+	}
+
+	{
+		const String code = "\n{ a: 1,\n\n\tb: { x\n} }\n";
+		const LineIndex index(code.data(), code.data() + code.size());
+		assert(index.lineCount() == 6);
+		LineAndColumn expected(1, 1);
+		for (size_t i = 0; i <= code.size(); ++i) {
+			assert(index.find(i) == expected);
+			expected = (i < code.size() && code[i] == '\n' ? LineAndColumn(expected.first + 1, 1)
+					: LineAndColumn(expected.first, expected.second + 1));
+		}
+		const Element source(code);
+		assert(source.lineAndColumn(source.begin() + code.find('x')) == LineAndColumn(4, 7));
+		assert(LineIndex(code.data(), code.data()).find(0) == LineAndColumn(1, 1));
+		try {
+			Element("{ a: 1\n } x").to<Struct>();
+			assert(0);
+		}
+		catch (const ParsingError& error) {
+			assert(error.getLineNumber() == 2 && error.getColumnNumber() == 4);
+		}
+	}
+
+	{
+		String code = "{\n";
+		String values = "first\n";
+		for (int i = 0; i < 20000; ++i) {
+			code += "\tk" + intToString(i) + ": { v: " + intToString(i) + ", s: \"}, /*\" } // ,\n";
+			values += "{ " + intToString(i) + " }, 'x\\'}'\n";
+		}
+		const Element source(code + "}\n");
+		Array array;
+		Struct structure;
+		FlatStruct flat;
+		parseParallel(Element(values), array, 3);
+		parseParallel(source, structure, 3);
+		parseParallel(source, flat, 3);
+		const Struct serial = source.to<Struct>();
+		assert(array.size() == 40001 && structure.size() == 20000 && flat.size() == 20000);
+		Struct::const_iterator it = serial.begin();
+		for (size_t i = 0; i < flat.size(); ++i, ++it) {
+			assert(structure[it->first].begin() == it->second.begin() && structure[it->first].end() == it->second.end());
+			assert(flat.begin()[i].first == it->first && flat.begin()[i].second.begin() == it->second.begin());
+			assert(array[i * 2 + 1].code() == "{ " + intToString(static_cast<int>(i)) + " }" && array[i * 2 + 2].code() == "'x\\'}'");
+		}
+		const Element duplicate(code + "k100: 1 }");
+		size_t failOffset = 0;
+		assert(!Parser(duplicate).tryToParse(structure, failOffset));
+		try {
+			parseParallel(duplicate, structure, 3);
+			assert(0);
+		}
+		catch (const ParsingError& error) {
+			assert(error.getOffset() == failOffset && failOffset == code.size());
+		}
+	}
+
+	{
+		Array array;
+		Struct structure;
+		HashStruct hashed;
+		structure["0"] = Element();	// missing first member still gets a separator after it (like compose())
+		for (int i = 0; i < 5000; ++i) {
+			const Element element(i % 3 == 0 ? "{\n\t\ta: " + intToString(i) + "\n\t}" : (i % 3 == 1 ? "x" : ""));
+			array.push_back(element);
+			structure[i % 7 == 0 ? "k " + intToString(i) : "k" + intToString(i)] = element;
+			hashed["h" + intToString(i)] = element;
+		}
+		for (int mode = 0; mode < 4; ++mode) {
+			const bool multiLine = ((mode & 1) != 0);
+			const bool bracket = ((mode & 2) != 0);
+			assert(composeParallel(array, multiLine, bracket, 3) == compose(array, multiLine, bracket));
+			assert(composeParallel(structure, multiLine, bracket, 3) == compose(structure, multiLine, bracket));
+			assert(composeParallel(hashed, multiLine, bracket, 3) == compose(hashed, multiLine, bracket));
+		}
+		array[4000] = Element();
+		try {
+			composeParallel(array, false, true, 3);
+			assert(0);
+		}
+		catch (const UndefinedElementError&) {
+		}
+	}
+
+	for (int multiLine = 0; multiLine < 2; ++multiLine) {
+		Array inner;
+		inner.push_back(Element(compose(1)));
+		inner.push_back(Element(compose("x y")));
+		inner.push_back(Element(""));
+		inner.push_back(Element("{\n\tq\n}"));
+		Struct outer;
+		outer["a"] = Element(compose(1.5));
+		outer["b c"] = Element(compose(inner, multiLine != 0));
+		outer["e"] = Element(compose(Struct(), multiLine != 0));
+		outer["f"] = Element(compose(Array(), multiLine != 0));
+		const String expected = compose(outer, multiLine != 0);
+		std::ostringstream stream;
+		OStreamSink sink(stream);
+		Composer composer(sink, multiLine != 0);
+		composer.beginStruct().key("a").value(1.5).key(String("b c")).beginArray().value(1).value("x y");
+		composer.value(Element("")).value(Element("{\n\tq\n}")).endArray();
+		composer.key(WideString(L"e")).beginStruct().endStruct().key("f").beginArray().endArray().endStruct().flush();
+		assert(stream.str() == expected && composer.depth() == 0);
+		Char chars[8];
+		BufferSink buffer(chars, sizeof (chars));
+		Composer(buffer, multiLine != 0).value(Element(expected));
+		assert(buffer.overflowed() && buffer.size() == expected.size() && String(chars, chars + 8) == expected.substr(0, 8));
+	}
+	{
+		const int DEPTH = 40;
+		Element nested("leaf");
+		for (int level = DEPTH - 1; level >= 0; --level) {
+			Struct structure;
+			structure["child"] = nested;
+			structure["level"] = Element(compose(level));
+			nested = Element(compose(structure, true));
+		}
+		std::ostringstream stream;
+		OStreamSink sink(stream);
+		Composer composer(sink, true);
+		for (int level = 0; level < DEPTH; ++level) {
+			composer.beginStruct().key("child");
+		}
+		composer.value(Element("leaf"));
+		for (int level = DEPTH - 1; level >= 0; --level) {
+			composer.key("level").value(level).endStruct();
+		}
+		composer.flush();
+		assert(stream.str() == nested.code());
+		const Struct parsed = nested.to<Struct>();
+		assert(compose(parsed, true) == nested.code() && parsed.find("child")->second.code().find("\n\t\t\tlevel: 2") != String::npos);
+	}
+	{
+		struct Collector {
+			Collector(String& text, size_t& writes) : text(text), writes(writes) { }
+			void operator()(const Char* chars, size_t count) { text.append(chars, count); ++writes; }
+			String& text;
+			size_t& writes;
+		};
+		Array numbers;
+		String text;
+		size_t writes = 0;
+		CallbackSink sink((Collector(text, writes)));
+		Composer composer(sink);
+		composer.beginArray();
+		for (int i = 0; i < 20000; ++i) {
+			numbers.push_back(Element(compose(i * 0.5)));
+			composer.value(i * 0.5);
+		}
+		composer.endArray().flush();
+		assert(text == compose(numbers) && writes > 1);
+		FILE* file = tmpfile();
+		assert(file != 0);
+		FileSink fileSink(file);
+		Composer(fileSink).value(true);
+		rewind(file);
+		Char chars[8] = { 0 };
+		assert(fread(chars, 1, sizeof (chars), file) == 4 && String(chars) == "true");
+		fclose(file);
+	}
+
+	{
+		const String path = "numbstrictMapTest.numbstrict";
+		const String text = "{ a: 1, b: { 'x', 'y' } }\n";
+		{
+			std::ofstream file(path.c_str(), std::ios::binary);
+			file << text;
+		}
+		SourceBuffer buffer;
+		assert(mapFile(path, buffer) && String(buffer.begin, buffer.end) == text);
+		const Element mapped(buffer, path);
+		assert(mapped.filename() == path && mapped.to<Struct>()["b"].to<Array>()[1].to<String>() == "y");
+		std::ofstream(path.c_str(), std::ios::binary).close();
+		assert(mapFile(path, buffer) && buffer.begin == buffer.end && Element(buffer).code().empty());
+		std::remove(path.c_str());
+		assert(!mapFile(path, buffer) && !mapFile(WideString(path.begin(), path.end()), buffer));
+#ifndef _WIN32
+		const String utf8Path = "numbstrictMapTest\xC3\xA9\xE2\x82\xAC.numbstrict";	// wide paths are mapped as UTF-8
+		{
+			std::ofstream file(utf8Path.c_str(), std::ios::binary);
+			file << text;
+		}
+		assert(mapFile(WideString(L"numbstrictMapTest\u00E9\u20AC.numbstrict"), buffer));
+		assert(String(buffer.begin, buffer.end) == text);
+		std::remove(utf8Path.c_str());
+		assert(mapFile(String("/dev/null"), buffer) && buffer.begin == buffer.end);	// devices and pipes are read
+		const String fifoPath = "numbstrictMapTest.fifo";
+		if (mkfifo(fifoPath.c_str(), 0600) == 0) {
+			std::thread writer([&fifoPath, &text]() {
+				std::ofstream fifo(fifoPath.c_str(), std::ios::binary);
+				fifo << text;
+			});
+			assert(mapFile(fifoPath, buffer) && String(buffer.begin, buffer.end) == text);
+			writer.join();
+			std::remove(fifoPath.c_str());
+		}
+#endif
+		const Element shared(SourceBuffer(std::make_shared<const String>("{ 1, 2 }")));
+		assert(shared.to<Array>()[1].to<int>() == 2 && shared.code() == "{ 1, 2 }");
+	}
+
+	{
+		const Element source("{ a: { b: { 1, 2.5, 'x' } }, 'c d': 3\n e: { : }\n }");
+		assert(source["a"]["b"][1].to<double>() == 2.5 && source["a"]["b"][2].to<String>() == "x");
+		const Cursor root(source);
+		assert(root["c d"].to<int>() == 3 && root["e"].size() == 0 && !root["e"]["x"].exists());
+		assert(root.size() == 3 && root[2].element().code() == "{ : }" && !root[3].exists());
+		assert(!root["z"].exists() && root["z"].toOptional<int>(7) == 7 && !root["a"]["b"][3].exists());
+		assert(!root["a"]["b"]["x"].exists() && !root["z"]["y"][size_t(0)].exists());
+		assert(Element("a: 1, b: 2")["b"].to<int>() == 2 && Element("1, 2")[1].to<int>() == 2);
+		assert(Element("{ a: 1, b: }}}")["a"].to<int>() == 1);	// siblings after `a` are not looked at
+		const Element invalid("{ a: 1 b: 2, c: 3 }");
+		size_t failOffset = 0;
+		Struct structure;
+		assert(!Parser(invalid).tryToParse(structure, failOffset));
+		try {
+			invalid["c"];
+			assert(0);
+		}
+		catch (const ParsingError& error) {
+			assert(error.getOffset() == failOffset);
+		}
+	}
+
 	{
 		const std::string structString("   \n \t  /* /*   */ */ \n   // /*  \n { /* /* \n */ */ }    /* // */ //");
 		Parser structParser(structString);
@@ -1985,6 +6442,87 @@ bool unitTest() {
 		assert(structure[L"q"].to<std::string>() == "");
 		assert(structure[L"w"].to<std::string>() == "");
 	}
+	{
+		const Element structString("   \n \t  /* /*   */ */ \n   // /*  \n { /* /* \n */ */  x /**/ :  23/*  */ 666   ,  '  y  ' : 'asfd' \n\n,\nz:'qwer'\n\"\\u0074\\u00E4st\":bbb\nq:\nw: }    /* // */ //");
+		ViewStruct structure;
+		assert(Parser(structString).tryToParse(structure));
+		assert(structure.size() == 6);
+		assert(structure["x"].to<std::string>() == "23 666");
+		assert(structure["  y  "].to<StringView>() == "asfd" && structure["  y  "].to<StringView>().isAliasing());
+		assert(structure["x"].to<StringView>() == "23 666" && !structure["x"].to<StringView>().isAliasing());
+		assert(structure["t\xE4st"].to<StringView>().str() == "bbb");
+		assert(structure["q"].to<StringView>().empty() && structure["w"].to<std::string>() == "");
+		for (ViewStruct::const_iterator it = structure.begin(); it != structure.end(); ++it) {
+			assert(it->first.isAliasing() == (it->first != "t\xE4st"));
+			assert(!it->first.isAliasing() || (it->first.begin() >= &*structString.begin()
+					&& it->first.end() <= &*(structString.end() - 1) + 1));
+		}
+		ViewStruct::const_iterator it = structure.begin();
+		Struct copy = structString.to<Struct>();
+		for (Struct::const_iterator jt = copy.begin(); jt != copy.end(); ++jt, ++it) {
+			assert(it->first.str() == jt->first);
+		}
+	}
+	{
+		const Element structString("{ b: 1, 'c d': { x }\na: 'q'\n\"\\u00E4\": 3, _0: }");
+		const Struct structure = structString.to<Struct>();
+		const FlatStruct flat = structString.to<FlatStruct>();
+		HashStruct hash = structString.to<HashStruct>();
+		assert(flat.size() == 5 && hash.size() == 5);
+		assert(compose(flat) == compose(structure) && compose(flat, true) == compose(structure, true));
+		assert(compose(hash) == "{ b: 1, \"c d\": { x }, a: 'q', \"\\xe4\": 3, _0:  }");
+		assert(compose(structString.to<WideFlatStruct>()) == compose(structString.to<WideStruct>()));
+		assert(structString.to<WideHashStruct>().begin()->first == L"b");
+		FlatStruct::const_iterator it = flat.begin();
+		for (Struct::const_iterator jt = structure.begin(); jt != structure.end(); ++jt, ++it) {
+			assert(it->first == jt->first && hash.find(jt->first)->second.code() == jt->second.code());
+		}
+		assert(flat.find("a")->second.to<String>() == "q" && flat.count("a") == 1 && flat.find("z") == flat.end());
+		assert(hash.find("z") == hash.end() && hash.count("c d") == 1 && !hash["z"].exists() && hash.size() == 6);
+		FlatStruct sorted;
+		assert(sorted.insert(std::make_pair(String("b"), Element("1"))).second && !sorted["a"].exists());
+		assert(!sorted.insert(std::make_pair(String("b"), Element("2"))).second && sorted["b"].to<int>() == 1);
+		const std::pair<String, Element> members[] = {
+			std::make_pair(String("y"), Element("1")), std::make_pair(String("x"), Element("2")),
+			std::make_pair(String("y"), Element("3"))
+		};
+		sorted.assign(members, members + 3);
+		assert(sorted.size() == 2 && sorted.begin()->first == "x" && sorted["y"].to<int>() == 1);
+		String source = "{";
+		for (int i = 99; i >= 0; --i) {
+			source += " k" + intToString(i) + ": " + intToString(i) + ",";
+		}
+		hash = Element(source + " }").to<HashStruct>();
+		const FlatStruct large = Element(source + " }").to<FlatStruct>();
+		for (int i = 0; i < 100; ++i) {
+			assert(hash["k" + intToString(i)].to<int>() == i && large.find("k" + intToString(i))->second.to<int>() == i);
+		}
+		assert(hash.size() == 100 && hash.begin()->first == "k99" && large.begin()->first == "k0");
+		size_t failOffset = 0;
+		assert(!Parser(Element("a:3,a:4")).tryToParse(hash, failOffset) && failOffset == 4 && hash.size() == 1);
+		assert(!Parser(Element(source + " k50: 0 }")).tryToParse(hash, failOffset) && failOffset == source.size() + 1);
+		FlatStruct flatFail;
+		assert(!Parser(Element("{ b: 1, a: 2, b: 3 }")).tryToParse(flatFail, failOffset) && failOffset == 14);
+		assert(flatFail.size() == 2 && flatFail.begin()->first == "a");
+	}
+	{
+		size_t failOffset = 0;
+		ViewStruct structure;
+		StringView view;
+		assert(!Parser(Element("a:3,a:4")).tryToParse(structure, failOffset) && failOffset == 4);
+		assert(!Parser(Element("{ a: 1, 'b\\q': 2 }")).tryToParse(structure, failOffset) && failOffset == 11);
+		assert(!Parser(Element("{ a: 1, 'b\\u0100': 2 }")).tryToParse(structure, failOffset) && failOffset == 12);
+		assert(!Parser(Element("'abc\n'")).tryToParse(view, failOffset) && failOffset == 4);
+		assert(!Parser(Element("'abc")).tryToParse(view, failOffset) && failOffset == 4);
+		assert(!Parser(Element("'abc' x")).tryToParse(view, failOffset) && failOffset == 6);
+		assert(!Parser(Element("abc { x")).tryToParse(view, failOffset) && failOffset == 4);
+		const Element text(" abc  /* */ ");
+		assert(Parser(text).tryToParse(view) && view == "abc" && view.begin() == &*text.begin() + 1);
+		assert(Element("'a\\tb'").to<StringView>() == "a\tb" && Element("'a\\tb'").to<String>() == "a\tb");
+		static_assert(!std::is_convertible<String, StringView>::value, "a temporary String would dangle as a key");
+		const String key("a");
+		assert(Element("{ a: 1 }").to<ViewStruct>()[StringView(key)].to<int>() == 1);
+	}
 
 	{
 		const Element structString("   \n \t  /* /*   */ */ \n   // /*  \n { /* /* \n */ */  x  : /* 23/*  */ 666   ,  '  y  ' : 'asfd' \n\n,\nz:'qwer'\naaa:bbb }    /* // */ //");
@@ -2140,44 +6678,185 @@ bool unitTest() {
 		Variant v;
 		Variant w;
 
-		v.type = Variant::STRUCT;
+		v.setStruct();
 		assert(compose(v) == "{ : }");
-		v.structure.insert(std::make_pair(L"abc", compose("tiktok")));
+		v.structure().insert(std::make_pair(L"abc", compose("tiktok")));
 		assert(compose(v) == "{ abc: \"tiktok\" }");
 		w = Element("{ abc: \"tiktok\" }").to<Variant>();
-		assert(w.type == Variant::STRUCT && w.structure.size() == 1);
+		assert(w.type() == Variant::STRUCT && w.structure().size() == 1);
 
-		v.type = Variant::ARRAY;
+		v.setArray();
 		assert(compose(v) == "{ }");
-		v.array.push_back(compose(1234.5678));
-		v.array.push_back(compose(-5984));
+		v.array().push_back(compose(1234.5678));
+		v.array().push_back(compose(-5984));
 		assert(compose(v) == "{ 1234.5678, -5984 }");
 		w = Element("{ 1234.5678, -5984 }").to<Variant>();
-		assert(w.type == Variant::ARRAY && w.array.size() == 2);
+		assert(w.type() == Variant::ARRAY && w.array().size() == 2);
 
-		v.type = Variant::TEXT;
-		v.text = L"arbitrary thing";
+		v.setText() = L"arbitrary thing";
 		assert(compose(v) == "\"arbitrary thing\"");
 		w = Element("\"arbitrary thing\"").to<Variant>();
-		assert(w.type == Variant::TEXT && w.text == L"arbitrary thing");
+		assert(w.type() == Variant::TEXT && w.text() == L"arbitrary thing");
 
-		v.type = Variant::REAL;
-		v.real = 12345.678;
+		v.setReal(12345.678);
 		assert(compose(v) == "12345.678");
 		w = Element("12345.678").to<Variant>();
-		assert(w.type == Variant::REAL && w.real == 12345.678);
+		assert(w.type() == Variant::REAL && w.real() == 12345.678);
 
-		v.type = Variant::INTEGER;
-		v.integer = 12345678;
+		v.setInteger(12345678);
 		assert(compose(v) == "12345678");
 		w = Element("12345678").to<Variant>();
-		assert(w.type == Variant::INTEGER && w.integer == 12345678);
+		assert(w.type() == Variant::INTEGER && w.integer() == 12345678);
 
-		v.type = Variant::UNSIGNED_INTEGER;
-		v.unsignedInteger = 0xeac0bff359aefc59ULL;
+		v.setUnsignedInteger(0xeac0bff359aefc59ULL);
 		assert(compose(v) == "0xeac0bff359aefc59");
 		w = Element("0xeac0bff359aefc59").to<Variant>();
-		assert(w.type == Variant::UNSIGNED_INTEGER && w.unsignedInteger == 0xeac0bff359aefc59ULL);
+		assert(w.type() == Variant::UNSIGNED_INTEGER && w.unsignedInteger() == 0xeac0bff359aefc59ULL);
+
+		assert(sizeof (Variant) <= 16);
+		Parser(Element("{ 1, 2 }")).parse(v);
+		const Variant copy(v);
+		Parser(Element("{ 3 }")).parse(v);
+		assert(copy.type() == Variant::ARRAY && copy.array().size() == 2 && v.array().size() == 1);
+		Variant moved(std::move(v));
+		assert(v.type() == Variant::INVALID && moved.type() == Variant::ARRAY && moved.array().size() == 1);
+		w = copy;
+		moved = w;
+		w = moved;
+		assert(compose(w) == "{ 1, 2 }" && compose(copy) == "{ 1, 2 }");
+		w = Variant();
+		assert(w.type() == Variant::INVALID);
+		Parser(Element("x")).parse(w);
+		assert(!Parser(Element("{ 1, x: 2 }")).tryToParse(w) && w.type() == Variant::INVALID);
+		size_t failOffset = 0;
+		assert(!Parser(Element("{ a: 1, 2 }")).tryToParse(w, failOffset) && failOffset == 8);
+		assert(!Parser(Element("{ 1, x: 2 }")).tryToParse(w, failOffset) && failOffset == 2);
+
+		w = Element("-9223372036854775808").to<Variant>();
+		assert(w.type() == Variant::INTEGER && w.integer() == std::numeric_limits<int64_t>::min());
+		w = Element("9223372036854775808").to<Variant>();
+		assert(w.type() == Variant::UNSIGNED_INTEGER && w.unsignedInteger() == 9223372036854775808ULL);
+		w = Element("18446744073709551615 // max").to<Variant>();
+		assert(w.type() == Variant::UNSIGNED_INTEGER && w.unsignedInteger() == 18446744073709551615ULL);
+		w = Element("23058430092136939520").to<Variant>();
+		assert(w.type() == Variant::REAL && w.real() == 23058430092136939520.0);
+		w = Element("-18446744073709551616").to<Variant>();
+		assert(w.type() == Variant::REAL && w.real() == -18446744073709551616.0);
+		w = Element("0x1ffffffffffffffff").to<Variant>();
+		assert(w.type() == Variant::TEXT);	// too large for any integer, and reals are decimal
+		w = Element("-9223372036854775809").to<Variant>();
+		assert(w.type() == Variant::REAL && w.real() == -9223372036854775809.0);
+		w = Element("-0x10").to<Variant>();
+		assert(w.type() == Variant::INTEGER && w.integer() == -16);
+		w = Element("-inf").to<Variant>();
+		assert(w.type() == Variant::REAL && w.real() == -std::numeric_limits<double>::infinity());
+		w = Element("-+5").to<Variant>();
+		assert(w.type() == Variant::TEXT && w.text() == L"-+5");
+		assert(Element("255").to<uint8_t>() == 255 && Element("-128").to<int8_t>() == -128);
+		uint8_t small;
+		assert(!Parser(Element("256")).tryToParse(small) && !Parser(Element("300")).tryToParse(small));
+		int8_t signedSmall;
+		assert(!Parser(Element("128")).tryToParse(signedSmall) && !Parser(Element("300")).tryToParse(signedSmall));
+		uint64_t large;
+		assert(!Parser(Element("23058430092136939520")).tryToParse(large));
+		int64_t signedLarge;
+		assert(!Parser(Element("-18446744073709551616")).tryToParse(signedLarge));
+		w = Element("12 apples").to<Variant>();
+		assert(w.type() == Variant::TEXT && w.text() == L"12 apples");
+		w = Element("{ 'a': { b: {} } }").to<Variant>();
+		assert(w.type() == Variant::STRUCT && w.structure().begin()->second.to<Variant>().type() == Variant::STRUCT);
+	}
+
+	{
+		const Document document = parseDocument("{ b: { 1, 2.5, '\\u20AC', { : } }, a: true // comment\n"
+				"\"q k\": { x: y z, \"\": 0xeac0bff359aefc59 }, c: , d: { } }");
+		const Document::Node root = document.root();
+		assert(root.type() == Variant::STRUCT && root.size() == 5);
+		assert(root[static_cast<size_t>(0)].key() == L"a" && root[4].key() == L"q k");
+		assert(root["a"].type() == Variant::BOOLEAN && root["a"].to<bool>());
+		assert(root["b"].type() == Variant::ARRAY && root["b"].size() == 4);
+		assert(root["b"][static_cast<size_t>(0)].to<int64_t>() == 1 && root["b"][static_cast<size_t>(0)].to<int>() == 1);
+		assert(root["b"][1].type() == Variant::REAL && root["b"][1].to<double>() == 2.5);
+		assert(root["b"][2].to<WideString>() == L"\u20AC");
+		assert(root["b"][3].type() == Variant::STRUCT && root["b"][3].size() == 0);
+		assert(root["b"][4].type() == Variant::INVALID && !root["b"][4].exists());
+		assert(root["c"].type() == Variant::TEXT && root["c"].to<String>() == "");
+		assert(root["d"].type() == Variant::ARRAY && root["d"].size() == 0);
+		assert(root["q k"]["x"].to<String>() == "y z");
+		assert(root[L"q k"][""].type() == Variant::UNSIGNED_INTEGER);
+		assert(root["q k"][""].to<uint64_t>() == 0xeac0bff359aefc59ULL);
+		assert(!root["e"].exists() && root["e"].toOptional<int>(3) == 3);
+		assert(root["b"].element().code() == "{ 1, 2.5, '\\u20AC', { : } }");
+		assert(root["b"].element().to<Array>().size() == 4);
+		assert(root["q k"]["x"].element().code() == "y z");
+	}
+	{
+		Document document;
+		size_t failOffset = 0;
+		assert(Parser(Element("  12345678  ")).tryToParse(document));
+		assert(document.root().type() == Variant::INTEGER && document.root().to<int>() == 12345678);
+		assert(!Parser(Element("{ a: { b: 1, b: 2 } }")).tryToParse(document, failOffset) && failOffset == 13);
+		assert(!document.exists());
+		assert(!Parser(Element("{ a: { 1, 2 ")).tryToParse(document, failOffset) && failOffset == 12);
+		assert(!Parser(Element("{ a: '\\q' }")).tryToParse(document, failOffset) && failOffset == 7);
+		assert(!Parser(Element("{ : x }")).tryToParse(document, failOffset) && failOffset == 4);
+		assert(Parser(Element("{ {},\n{ a: 1 }\n{ a: 2 } }")).tryToParse(document));
+		assert(document.root()[1]["a"].to<int>() == 1 && document.root()[2]["a"].to<int>() == 2);
+		assert(Parser(Element(" // x\n b: { 1 }\n a: 2 ")).tryToParse(document) && document.root().size() == 2);
+		assert(document.root().type() == Variant::STRUCT && document.root()["b"][size_t(0)].to<int>() == 1);
+		assert(Parser(Element(" : ")).tryToParse(document) && document.root().type() == Variant::STRUCT);
+		assert(!Parser(Element(": a: 1")).tryToParse(document, failOffset) && failOffset == 2);
+		assert(!Parser(Element("a: 1 }")).tryToParse(document, failOffset) && failOffset == 5);
+		assert(!Parser(Element("a: 1\na: 2")).tryToParse(document, failOffset) && failOffset == 5);
+	}
+	{
+		const Document document = parseDocument("{ -128, 127, 255, 65535, -2147483648, 4294967295, 128, -1, -0, 0x7F"
+				", 0.1, 3.4028235e38, 3.4028236e38, 1e39, 1e-45, 1e-30, -0.0, 1.0000000596046447753906251"
+				", 1.00000005960464478 }");	// the last two round to a double halfway between two floats
+		const Document::Node root = document.root();
+		assert(root[size_t(0)].to<int8_t>() == -128 && root[1].to<int8_t>() == 127 && root[2].to<uint8_t>() == 255);
+		assert(root[3].to<uint16_t>() == 65535 && root[4].to<int32_t>() == -2147483647 - 1);
+		assert(root[5].to<uint32_t>() == 4294967295U && root[9].to<int8_t>() == 127 && root[1].to<uint8_t>() == 127);
+		// index of the element and 0, 1 or 2 to read it as uint8_t, int8_t or uint32_t
+		const size_t outOfRange[][2] = { { 6, 1 }, { 7, 0 }, { 8, 0 }, { 2, 1 }, { 4, 2 } };
+		for (size_t i = 0; i < sizeof (outOfRange) / sizeof (*outOfRange); ++i) {
+			const Document::Node node = root[outOfRange[i][0]];
+			try {
+				switch (outOfRange[i][1]) {
+					case 0: node.to<uint8_t>(); break;
+					case 1: node.to<int8_t>(); break;
+					default: node.to<uint32_t>(); break;
+				}
+				assert(0);
+			}
+			catch (const ParsingError&) {
+			}
+		}
+		for (size_t i = 10; i < root.size(); ++i) {
+			const float f = root[i].to<float>();
+			const float expected = root[i].element().to<float>();
+			assert(memcmp(&f, &expected, sizeof (f)) == 0);
+		}
+	}
+	{
+		String source = "{";
+		for (int i = 0; i < 40; ++i) {
+			source += " k" + intToString(i) + ": \"" + String(i * 10, 'x') + "\",";
+		}
+		Document document;
+		assert(Parser(Element(source + " }")).tryToParse(document));
+		assert(document.root().size() == 40 && document.root()["k39"].to<String>().size() == 390);
+		const Document copy = document;
+		assert(Parser(Element(source + " }")).tryToParse(document));
+		assert(document.getArena() != copy.getArena() && copy.root()["k3"].to<String>() == "xxxxxxxxxxxxxxxxxxxxxxxxxxxxxx");
+		assert(Parser(Element(source + " }")).tryToParse(document));
+		const size_t allocationCount = document.getArena()->getAllocationCount();
+		assert(Parser(Element(source + " }")).tryToParse(document));
+		assert(document.getArena()->getAllocationCount() == allocationCount);
+		assert(document.root().size() == 40 && document.root()["k0"].to<String>() == "");
+		size_t failOffset = 0;
+		assert(!Parser(Element(source + " k2: 0 }")).tryToParse(document, failOffset) && failOffset == source.size() + 1);
+		assert(!Parser(Element("{ k1: 0, k0: 1, k1: 2 }")).tryToParse(document, failOffset) && failOffset == 16);
 	}
 #endif
 
@@ -3,26 +3,47 @@
 
 #include "assert.h"
 #include <map>
+#include <set>
 #include <vector>
 #include <string>
 #include <exception>
 #include <memory>
+#include <atomic>
 #include <cstdint>
+#include <algorithm>
+#include <iterator>
+#include <iosfwd>
+#include <functional>
+#include <type_traits>
+#include <cstdio>
 
 namespace Numbstrict {
 
 class Element;
 class Parser;
+class Document;
+class Cursor;
+class StringView;
+template<typename K> class BasicFlatStruct;
+template<typename K> class BasicHashStruct;
 typedef char Char;
 typedef unsigned char UChar;
 typedef wchar_t WideChar;
 typedef std::basic_string<Char> String;	// notice: not utf8, assumed ISO-8859-1!
 typedef std::basic_string<WideChar> WideString;
-typedef std::basic_string<Char>::const_iterator StringIt;
+typedef const Char* StringIt;	// into the source, which is not necessarily a String (see SourceBuffer)
 typedef std::basic_string<WideChar>::const_iterator WideStringIt;
 typedef std::vector<Element> Array;
 typedef std::map<String, Element> Struct;	// standard struct handles only iso-8859-1 keys
 typedef std::map<WideString, Element> WideStruct;	// a wide struct can handle any unicode keys
+typedef std::map<StringView, Element> ViewStruct;	// keys alias the source code when possible (see StringView)
+typedef BasicFlatStruct<String> FlatStruct;	// sorted vector instead of std::map (see BasicFlatStruct)
+typedef BasicFlatStruct<WideString> WideFlatStruct;
+typedef BasicHashStruct<String> HashStruct;	// vector in source order with hash index (see BasicHashStruct)
+typedef BasicHashStruct<WideString> WideHashStruct;
+
+// Specialized by NUMBSTRICT_FIELDS (see the end of this file) for structs that are bound to Numbstrict structs.
+template<typename T> struct Fields { enum { BOUND = 0 }; };
 
 struct Exception : public std::exception { virtual ~Exception() throw() { } };
 
@@ -66,44 +87,226 @@ class ParsingError : public Exception {
 		mutable std::string errorString;
 };
 
+// Thrown by Schema::validate() where the source doesn't match the schema, and by Schema() for invalid schemas.
+class SchemaError : public ParsingError {
+	public:
+		SchemaError(const String& filename, size_t offset, int line, int column, const String& reason)
+				: ParsingError(filename, offset, line, column), reason(reason) { }
+		virtual const char* what() const throw();
+		String getReason() const { return reason; }
+		virtual ~SchemaError() throw() { }
+
+	protected:
+		const String reason;
+		mutable std::string schemaErrorString;
+};
+
 /**
 	Notice that type is deduced from text contents and there may be ambiguities, e.g. an empty struct might be
-	identified as an empty array. Implementation does not depend on C++11 non-trival class unions and stores structures
-	and arrays separately for simplicity. If we based this on C++17 we could have used std::variant instead.
+	identified as an empty array.
+
+	A Variant is a tagged union: scalars are stored inline and a struct, array or text is allocated only while the
+	Variant holds one, so a Variant is 16 bytes (plus the container, if any). Read the value with the accessor that
+	matches type() (asserted). Set it with one of the set functions. setStruct(), setArray() and setText() return an
+	empty container to fill in, and reuse the one the Variant already holds if it is of the same type (e.g. when
+	parsing into the same Variant in a loop).
+
+	This replaces the public members `type`, `structure`, `array`, `text`, `real` etc of earlier versions, which is a
+	breaking change (see the Variant section of the documentation for how to port code that used them).
+**/
+class Variant {
+	public:
+		enum Type {
+			INVALID
+			, STRUCT 			// { : }
+			, ARRAY 			// { }
+			, TEXT 				// "" '' and generic text (including unparsable { } elements)
+			, REAL 				// #.#
+			, UNSIGNED_INTEGER	// [+]# (only overflowing 64-bit integers)
+			, INTEGER 			// [+-]#
+			, BOOLEAN 			// true | false
+		};
+		Variant() : kind(INVALID) { value.unsignedInteger = 0; }
+		Variant(const Variant& other);
+		Variant(Variant&& other) : kind(other.kind), value(other.value) { other.kind = INVALID; }
+		Variant& operator=(const Variant& other);
+		Variant& operator=(Variant&& other);
+		~Variant() { clear(); }
+		Type type() const { return kind; }
+		void clear();											// back to INVALID
+		WideStruct& setStruct();
+		Array& setArray();
+		WideString& setText();
+		void setReal(double real) { clear(); kind = REAL; value.real = real; }
+		void setInteger(int64_t integer) { clear(); kind = INTEGER; value.integer = integer; }
+		void setUnsignedInteger(uint64_t unsignedInteger) {
+			clear();
+			kind = UNSIGNED_INTEGER;
+			value.unsignedInteger = unsignedInteger;
+		}
+		void setBoolean(bool boolean) { clear(); kind = BOOLEAN; value.boolean = boolean; }
+		WideStruct& structure() { assert(kind == STRUCT); return *value.structure; }
+		const WideStruct& structure() const { assert(kind == STRUCT); return *value.structure; }
+		Array& array() { assert(kind == ARRAY); return *value.array; }
+		const Array& array() const { assert(kind == ARRAY); return *value.array; }
+		WideString& text() { assert(kind == TEXT); return *value.text; }
+		const WideString& text() const { assert(kind == TEXT); return *value.text; }
+		double real() const { assert(kind == REAL); return value.real; }
+		int64_t integer() const { assert(kind == INTEGER); return value.integer; }
+		uint64_t unsignedInteger() const { assert(kind == UNSIGNED_INTEGER); return value.unsignedInteger; }
+		bool boolean() const { assert(kind == BOOLEAN); return value.boolean; }
+
+	protected:
+		Type kind;
+		union {
+			WideStruct* structure;
+			Array* array;
+			WideString* text;
+			double real;
+			int64_t integer;
+			uint64_t unsignedInteger;
+			bool boolean;
+		} value;
+};
+
+/**
+	A StringView is a read-only range of (ISO-8859-1) chars. When parsed from an Element, it points straight into the
+	source code for identifiers, unquoted text and quoted strings without escapes, and only holds its own unescaped copy
+	when necessary. Such an aliasing view is valid as long as the source is, i.e. as long as any Element of the same
+	source exists. (The keys of a ViewStruct are always valid since its Elements keep the source alive.)
+
+	A view of a String aliases the String, so that constructor is explicit: a temporary String can't silently become a
+	dangling key, e.g. in `viewStruct[a + b]`. Views order and compare just like String.
+**/
+class StringView {
+	public:
+		StringView() : b(0), e(0) { }
+		StringView(const Char* s) : b(s), e(s + std::char_traits<Char>::length(s)) { }
+		explicit StringView(const String& s) : b(s.data()), e(s.data() + s.size()) { }	// aliases `s`
+		StringView(const Char* begin, const Char* end) : b(begin), e(end) { }
+		explicit StringView(const std::shared_ptr<const String>& owned)
+				: b(owned->data()), e(owned->data() + owned->size()), owned(owned) { }
+		const Char* begin() const { return b; }
+		const Char* end() const { return e; }
+		const Char* data() const { return b; }
+		size_t size() const { return e - b; }
+		bool empty() const { return b == e; }
+		Char operator[](size_t i) const { assert(i < size()); return b[i]; }
+		bool isAliasing() const { return !owned; }	// false if this view holds its own (unescaped) copy
+		String str() const { return String(b, e); }
+		int compare(const StringView& other) const;
+
+	protected:
+		const Char* b;
+		const Char* e;
+		std::shared_ptr<const String> owned;
+};
+
+inline bool operator==(const StringView& a, const StringView& b) { return a.compare(b) == 0; }
+inline bool operator!=(const StringView& a, const StringView& b) { return a.compare(b) != 0; }
+inline bool operator<(const StringView& a, const StringView& b) { return a.compare(b) < 0; }
+
+/**
+	A StructuralIndex is an optional pre-pass over an entire source that lists the offsets of all structural chars
+	outside of quoted strings and comments, i.e. `{ } : ,` and line feeds, plus the quotes that begin and end strings
+	and the '/' chars that begin and end comments. It is built in a single sweep with the same (SIMD) scanning as the
+	parser. Each opening brace, quote and block comment is linked to its closing partner.
+
+	Build it with Element::indexStructure(). It is then shared by all Elements of the same source, and Parsers use it to
+	skip nested blocks and quoted strings in constant time instead of scanning them. Without it, parsing a deeply nested
+	source level by level (e.g. with to<Struct>()) scans the innermost blocks once per level.
 **/
-struct Variant {
-	enum Type {
-		INVALID
-		, STRUCT 			// { : }
-		, ARRAY 			// { }
-		, TEXT 				// "" '' and generic text (including unparsable { } elements)
-		, REAL 				// #.#
-		, UNSIGNED_INTEGER	// [+]# (only overflowing 64-bit integers)
-		, INTEGER 			// [+-]#
-		, BOOLEAN 			// true | false
-	} type;
-	Variant() : type(INVALID) { }
-	WideStruct structure;
-	Array array;
-	WideString text;
-	union {
-		double real;
-		int64_t integer;
-		uint64_t unsignedInteger;
-		bool boolean;
-	};
-};
-
-typedef std::pair<String, String> SourceAndFile;
+class StructuralIndex {
+	public:
+		static const size_t NONE = static_cast<size_t>(-1);
+		StructuralIndex(const Char* begin, const Char* end);
+		size_t size() const { return offsets.size(); }
+		size_t offset(size_t i) const { assert(i < offsets.size()); return offsets[i]; }	// source offset of entry `i`
+		size_t partner(size_t i) const { assert(i < partners.size()); return partners[i]; }	// or NONE if unpaired
+		size_t find(size_t offset) const;	// index of entry at source `offset` or NONE (constant time)
+
+	protected:
+		enum { DIRECTORY_SPACING = 256 };
+		void add(size_t offset);
+		void link(size_t opening, size_t closing);
+		std::vector<size_t> offsets;
+		std::vector<size_t> partners;
+		std::vector<size_t> directory;	// first entry at or after every DIRECTORY_SPACING:th source offset
+};
+
 typedef std::pair<int, int> LineAndColumn;
 
+/**
+	A LineIndex lists the offsets where the lines of a source begin, so that the line and column of an offset is found
+	with a binary search instead of by counting line feeds from the beginning of the source. Element::lineAndColumn()
+	builds one on its first call and shares it with all Elements of the same source.
+**/
+class LineIndex {
+	public:
+		LineIndex(const Char* begin, const Char* end);
+		size_t lineCount() const { return lineStarts.size(); }
+		LineAndColumn find(size_t offset) const;	// 1-based line and column of source `offset`
+
+	protected:
+		std::vector<size_t> lineStarts;
+};
+
+/**
+	A SourceBuffer is a read-only range of source code chars in memory together with a shared pointer that keeps them
+	valid, e.g. a memory-mapped file (see mapFile()) or a String shared with the caller. Elements created from a
+	SourceBuffer parse it in place, without copying.
+**/
+struct SourceBuffer {
+	SourceBuffer() : begin(0), end(0) { }
+	SourceBuffer(const Char* begin, const Char* end, const std::shared_ptr<const void>& owner)
+			: owner(owner), begin(begin), end(end) { }
+	explicit SourceBuffer(const std::shared_ptr<const String>& string)
+			: owner(string), begin(string->data()), end(string->data() + string->size()) { }
+	std::shared_ptr<const void> owner;
+	const Char* begin;
+	const Char* end;
+};
+
+/**
+	Maps the file at `path` into memory read-only and returns false if it can't be opened or mapped. The pages are
+	loaded on demand and shared with other processes that read the same file. The file should not be modified while
+	mapped. Pipes, devices and other files that can't be mapped are read into a String instead. On Windows both paths
+	are opened as wide paths (a String path is ISO-8859-1), so use a WideString for other characters. Elsewhere a String
+	path is used as is, and a WideString path is encoded as UTF-8.
+**/
+bool mapFile(const String& path, SourceBuffer& buffer);
+bool mapFile(const WideString& path, SourceBuffer& buffer);
+
+/**
+	The source code and filename shared by all Elements parsed from the same code. The code is either an own copy or
+	an external SourceBuffer. Optional indexes built on demand are attached here.
+**/
+struct SourceAndFile {
+	SourceAndFile(const String& code, const String& filename)
+			: copy(code), filename(filename), begin(copy.data()), end(copy.data() + copy.size()), structuralIndex(0) { }
+	SourceAndFile(const SourceBuffer& buffer, const String& filename)
+			: owner(buffer.owner), filename(filename), begin(buffer.begin), end(buffer.end), structuralIndex(0) { }
+	~SourceAndFile() { delete structuralIndex.load(); }
+	const String copy;							// empty for a SourceBuffer
+	const std::shared_ptr<const void> owner;	// of a SourceBuffer
+	const String filename;
+	const Char* const begin;
+	const Char* const end;
+	std::atomic<const StructuralIndex*> structuralIndex;	// owned, set once by Element::indexStructure() (thread-safe)
+	std::shared_ptr<const LineIndex> lineIndex;		// built by the first Element::lineAndColumn() (thread-safe)
+
+	private:
+		SourceAndFile(const SourceAndFile&);	// non-copyable (`begin` may point into `copy`)
+		SourceAndFile& operator=(const SourceAndFile&);
+};
+
 /**
 	An Element represents the entire source code text or a partially parsed or composed piece of it. It maintains a
-	shared pointer to the original source String (and optional filename) and iterators that designates a range within
+	shared pointer to the original source code (and optional filename) and iterators that designates a range within
 	that source.
 
 	Use to<type>() to attempt parsing the Element source code into one of the supported types: Array, Struct, String,
-	WideString, double, float, int, bool and Variant.
+	WideString, double, float, int, bool and Variant. ViewStruct and StringView parse without copying keys and texts.
 
 	Use one of the overloaded global compose() functions to create an Element from one of the supported types.
 	
@@ -114,9 +317,11 @@ typedef std::pair<int, int> LineAndColumn;
 **/
 class Element {
 	public:
-		Element() { }
+		Element() : b(), e() { }
 		Element(const String& code, const String& filename = String())
-				: s(std::make_shared<SourceAndFile>(code, filename)), b(s->first.begin()), e(s->first.end()) { }
+				: s(std::make_shared<SourceAndFile>(code, filename)), b(s->begin), e(s->end) { }
+		Element(const SourceBuffer& buffer, const String& filename = String())		// does not copy the source
+				: s(std::make_shared<SourceAndFile>(buffer, filename)), b(s->begin), e(s->end) { }
 		Element(const Element& parent, const StringIt begin, const StringIt end) : s(parent.s), b(begin), e(end) { }
 		bool exists() const { return static_cast<bool>(s); }
 		StringIt begin() const { assert(exists()); return b; }
@@ -126,9 +331,14 @@ class Element {
 		template<typename T> bool tryToParse(T& target) const;       // expects convertible to `T`; false on failure
 		String code() const { if (!exists()) { throw UndefinedElementError(); }; return String(b, e); }
 		String optionalCode(const String& defaultCode = String()) const { return (!exists() ? defaultCode : code()); }
-		String filename() const { assert(exists()); return s->second; }
-		size_t offset(const StringIt p) const { assert(exists()); return p - s->first.begin(); }    // `p` = source iterator
-		LineAndColumn lineAndColumn(StringIt p) const;                // `p` = source iterator
+		String filename() const { assert(exists()); return s->filename; }
+		size_t offset(const StringIt p) const { assert(exists()); return p - s->begin; }    // `p` = source iterator
+		LineAndColumn lineAndColumn(StringIt p) const;                // `p` = source iterator (see LineIndex)
+		void indexStructure() const;	// builds a StructuralIndex once (thread-safe) for all Elements of the source
+		const StructuralIndex* structuralIndex() const { assert(exists()); return s->structuralIndex.load(); }	// or 0
+		Cursor operator[](size_t i) const;			// lazy navigation, see Cursor
+		Cursor operator[](const String& key) const;
+		Cursor operator[](const Char* key) const;
 	
 	protected:
 		std::shared_ptr<SourceAndFile> s;
@@ -136,6 +346,351 @@ class Element {
 		StringIt e;
 };
 
+/**
+	Alternatives to the std::map based Struct that store all members in a single vector. Select one by parsing to it,
+	e.g. `element.to<FlatStruct>()`. The interface is a subset of std::map's. Like std::map, operator[] inserts an
+	undefined Element for a missing key. Don't modify keys through iterators.
+
+	BasicFlatStruct keeps members sorted by key (iterates like std::map) and finds keys with binary search. Inserting
+	in the middle is linear, so prefer assign() or parsing for building large structs.
+
+	BasicHashStruct keeps members in insertion (i.e. source) order and finds keys with an open-addressing hash index.
+
+	Both reject duplicate keys when parsing, with the same fail offset as Struct.
+**/
+template<typename K> class BasicFlatStruct {
+	friend class Parser;
+	friend class ParallelChunkParser;
+
+	public:
+		typedef K key_type;
+		typedef Element mapped_type;
+		typedef std::pair<K, Element> value_type;
+		typedef typename std::vector<value_type>::iterator iterator;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+		iterator begin() { return members.begin(); }
+		iterator end() { return members.end(); }
+		const_iterator begin() const { return members.begin(); }
+		const_iterator end() const { return members.end(); }
+		size_t size() const { return members.size(); }
+		bool empty() const { return members.empty(); }
+		void clear() { members.clear(); }
+		void reserve(size_t n) { members.reserve(n); }
+		iterator find(const K& key) { return members.begin() + indexOf(key); }
+		const_iterator find(const K& key) const { return members.begin() + indexOf(key); }
+		size_t count(const K& key) const { return (indexOf(key) != members.size() ? 1 : 0); }
+		Element& operator[](const K& key) { return insert(value_type(key, Element())).first->second; }
+		std::pair<iterator, bool> insert(const value_type& member) { return insert(value_type(member)); }
+		std::pair<iterator, bool> insert(value_type&& member);
+		template<typename I> void assign(I begin, I end);	// on duplicate keys, the first one is kept (like insert())
+
+	protected:
+		struct KeyOrder {
+			bool operator()(const value_type& a, const value_type& b) const { return a.first < b.first; }
+			bool operator()(const value_type& a, const K& b) const { return a.first < b; }
+		};
+		size_t indexOf(const K& key) const;
+		std::vector<value_type> members;
+};
+
+template<typename K> std::pair<typename BasicFlatStruct<K>::iterator, bool> BasicFlatStruct<K>::insert(
+		value_type&& member) {
+	const iterator it = std::lower_bound(members.begin(), members.end(), member.first, KeyOrder());
+	if (it != members.end() && !(member.first < it->first)) {
+		return std::make_pair(it, false);
+	}
+	return std::make_pair(members.insert(it, std::move(member)), true);
+}
+
+template<typename K> template<typename I> void BasicFlatStruct<K>::assign(I begin, I end) {
+	members.assign(begin, end);
+	std::stable_sort(members.begin(), members.end(), KeyOrder());
+	iterator to = members.begin();
+	for (iterator it = members.begin(); it != members.end(); ++it) {
+		if (to == members.begin() || (to - 1)->first < it->first) {
+			if (to != it) {
+				*to = std::move(*it);
+			}
+			++to;
+		}
+	}
+	members.erase(to, members.end());
+}
+
+template<typename K> size_t BasicFlatStruct<K>::indexOf(const K& key) const {
+	const const_iterator it = std::lower_bound(members.begin(), members.end(), key, KeyOrder());
+	return (it != members.end() && !(key < it->first) ? it - members.begin() : members.size());
+}
+
+template<typename K> class BasicHashStruct {
+	friend class Parser;
+
+	public:
+		typedef K key_type;
+		typedef Element mapped_type;
+		typedef std::pair<K, Element> value_type;
+		typedef typename std::vector<value_type>::iterator iterator;
+		typedef typename std::vector<value_type>::const_iterator const_iterator;
+		iterator begin() { return members.begin(); }
+		iterator end() { return members.end(); }
+		const_iterator begin() const { return members.begin(); }
+		const_iterator end() const { return members.end(); }
+		size_t size() const { return members.size(); }
+		bool empty() const { return members.empty(); }
+		void clear() { members.clear(); slots.clear(); }
+		void reserve(size_t n) { members.reserve(n); }
+		iterator find(const K& key) { return members.begin() + indexOf(key, hash(key)); }
+		const_iterator find(const K& key) const { return members.begin() + indexOf(key, hash(key)); }
+		size_t count(const K& key) const { return (indexOf(key, hash(key)) != members.size() ? 1 : 0); }
+		Element& operator[](const K& key) { return insert(value_type(key, Element())).first->second; }
+		std::pair<iterator, bool> insert(const value_type& member) { return insert(value_type(member)); }
+		std::pair<iterator, bool> insert(value_type&& member);
+
+	protected:
+		struct Slot {
+			uint32_t hash;
+			uint32_t index;		// index + 1 into `members`, 0 for empty slots
+		};
+		enum { LINEAR_SEARCH_LIMIT = 8 };	// small structs are searched linearly and have no index (no `slots`)
+		static uint32_t hash(const K& key);
+		size_t indexOf(const K& key, uint32_t hash) const;
+		void rehash();
+		std::vector<value_type> members;
+		std::vector<Slot> slots;	// size is zero or a power of two, at most half full
+};
+
+template<typename K> uint32_t BasicHashStruct<K>::hash(const K& key) {
+	uint32_t h = 2166136261U;
+	for (typename K::const_iterator it = key.begin(); it != key.end(); ++it) {
+		h = (h ^ static_cast<uint32_t>(*it)) * 16777619U;
+	}
+	h = (h ^ (h >> 16)) * 0x85EBCA6BU;	// FNV-1a alone leaves the low bits (used for slots) poorly mixed
+	return h ^ (h >> 13);
+}
+
+template<typename K> size_t BasicHashStruct<K>::indexOf(const K& key, uint32_t hash) const {
+	if (slots.empty()) {
+		for (size_t i = 0; i < members.size(); ++i) {
+			if (members[i].first == key) {
+				return i;
+			}
+		}
+	} else {
+		const size_t mask = slots.size() - 1;
+		for (size_t i = hash & mask; slots[i].index != 0; i = (i + 1) & mask) {
+			if (slots[i].hash == hash && members[slots[i].index - 1].first == key) {
+				return slots[i].index - 1;
+			}
+		}
+	}
+	return members.size();
+}
+
+template<typename K> void BasicHashStruct<K>::rehash() {
+	size_t n = LINEAR_SEARCH_LIMIT * 4;
+	while (n < members.size() * 4) {
+		n *= 2;
+	}
+	slots.assign(n, Slot());
+	for (size_t j = 0; j < members.size(); ++j) {
+		const uint32_t h = hash(members[j].first);
+		size_t i = h & (n - 1);
+		while (slots[i].index != 0) {
+			i = (i + 1) & (n - 1);
+		}
+		slots[i].hash = h;
+		slots[i].index = static_cast<uint32_t>(j + 1);
+	}
+}
+
+template<typename K> std::pair<typename BasicHashStruct<K>::iterator, bool> BasicHashStruct<K>::insert(
+		value_type&& member) {
+	const bool indexed = (members.size() >= LINEAR_SEARCH_LIMIT);
+	const uint32_t h = (indexed ? hash(member.first) : 0);
+	const size_t index = (indexed && slots.empty() ? (rehash(), indexOf(member.first, h)) : indexOf(member.first, h));
+	if (index != members.size()) {
+		return std::make_pair(members.begin() + index, false);
+	}
+	members.push_back(std::move(member));
+	if (indexed) {
+		if (members.size() * 2 > slots.size()) {
+			rehash();
+		} else {
+			const size_t mask = slots.size() - 1;
+			size_t i = h & mask;
+			while (slots[i].index != 0) {
+				i = (i + 1) & mask;
+			}
+			slots[i].hash = h;
+			slots[i].index = static_cast<uint32_t>(members.size());
+		}
+	}
+	return std::make_pair(members.end() - 1, true);
+}
+
+/**
+	KeySet<K> maps the keys of a fixed set to their indices in constant time, with a perfect hash that is searched for
+	at compile time (like the generated one of findReservedKeyword() in Makaron). `K` lists 1 to 64 keys in one literal,
+	separated with commas (keys can't contain commas or spaces):
+
+		struct ColorKeys { static constexpr const Numbstrict::Char* keys() { return "red, green, blue"; } };
+
+		KeySet<ColorKeys>::find(key)	// 0, 1, 2 or -1
+
+	Parse a struct to a KeySlots<K> to get its members in an array by key index instead of a Struct. Unknown keys fail
+	like duplicate keys, at the same point as in a Struct. NUMBSTRICT_FIELDS structs look up their keys with KeySet.
+**/
+class KeyHash {
+	public:
+		enum { SEEDS = 1024, MASK_DOUBLINGS = 1 };
+		static uint32_t of(const Char* key, size_t length, uint32_t seed) {
+			uint32_t h = BASIS;
+			for (size_t i = 0; i < length; ++i) {
+				h = step(h, key[i]);
+			}
+			return mix(h ^ seed);
+		}
+
+		/*
+			Compile-time search below. `s` points at a key in the literal, or at its terminating zero. Keys are hashed
+			once (without the seed), so trying a seed only mixes integers.
+		*/
+		enum : uint32_t { BASIS = 2166136261U };
+		static constexpr uint32_t seed(int attempt) { return static_cast<uint32_t>(attempt) * 0x9E3779B9U; }
+		static constexpr uint32_t step(uint32_t h, Char c) { return (h ^ static_cast<UChar>(c)) * 16777619U; }
+		static constexpr uint32_t mix(uint32_t h) { return mixed((h ^ (h >> 16)) * 0x85EBCA6BU); }	// as BasicHashStruct
+		static constexpr uint32_t mixed(uint32_t h) { return h ^ (h >> 13); }
+		static constexpr bool isSeparator(Char c) { return c == ',' || c == ' '; }
+		static constexpr const Char* skipSeparators(const Char* s) {
+			return (isSeparator(*s) ? skipSeparators(s + 1) : s);
+		}
+		static constexpr const Char* next(const Char* s) {
+			return (*s == 0 || isSeparator(*s) ? skipSeparators(s) : next(s + 1));
+		}
+		static constexpr uint32_t ofKey(const Char* s, uint32_t h) {	// before mix() with the seed
+			return (*s == 0 || isSeparator(*s) ? h : ofKey(s + 1, step(h, *s)));
+		}
+		static constexpr int count(const Char* s) { return (*s == 0 ? 0 : 1 + count(next(s))); }
+
+		// `h` points at KeyHashes::HASHES, `count` of them.
+		static constexpr uint32_t slotOf(uint32_t h, uint32_t seed, uint32_t mask) { return mix(h ^ seed) & mask; }
+		static constexpr bool collides(const uint32_t* h, int count, uint32_t slot, uint32_t seed, uint32_t mask) {
+			return (count > 0 && (slotOf(*h, seed, mask) == slot || collides(h + 1, count - 1, slot, seed, mask)));
+		}
+		static constexpr bool isPerfect(const uint32_t* h, int count, uint32_t seed, uint32_t mask, int index) {
+			return (index == count || (!collides(h, index, slotOf(h[index], seed, mask), seed, mask)
+					&& isPerfect(h, count, seed, mask, index + 1)));	// fails early with few keys checked
+		}
+		static constexpr bool isUnique(const uint32_t* h, int count) { return isPerfect(h, count, 0, ~0U, 1); }
+		// First perfect seed of `attempts` from `attempt` or -1, searched in halves to keep the recursion shallow.
+		static constexpr int findSeed(const uint32_t* h, int count, uint32_t mask, int attempt, int attempts) {
+			return (attempts == 1 ? (isPerfect(h, count, seed(attempt), mask, 1) ? attempt : -1)
+					: findSeed(h, count, mask, attempt, attempts / 2) >= 0
+					? findSeed(h, count, mask, attempt, attempts / 2)
+					: findSeed(h, count, mask, attempt + attempts / 2, attempts - attempts / 2));
+		}
+		static constexpr uint32_t findMask(const uint32_t* h, int count, uint32_t mask, int doublings) {	// 0 if none
+			return (doublings < 0 ? 0 : (findSeed(h, count, mask, 0, SEEDS) >= 0 ? mask
+					: findMask(h, count, mask * 2 + 1, doublings - 1)));
+		}
+		static constexpr uint32_t minimumMask(uint32_t count, uint32_t mask) {	// where a seed is likely to be perfect
+			return (mask + 1 >= 2 * count && mask + 1 >= count * count / 8 ? mask : minimumMask(count, mask * 2 + 1));
+		}
+		static constexpr int indexOf(const uint16_t* slots, int count, uint16_t slot, int index) {
+			return (index == count ? -1 : (slots[index] == slot ? index : indexOf(slots, count, slot, index + 1)));
+		}
+};
+
+template<int... I> struct KeyIndices { };
+template<typename A, typename B> struct JoinKeyIndices;
+template<int... A, int... B> struct JoinKeyIndices< KeyIndices<A...>, KeyIndices<B...> > {
+	typedef KeyIndices<A..., (static_cast<int>(sizeof...(A)) + B)...> Type;
+};
+template<int N> struct MakeKeyIndices {
+	typedef typename JoinKeyIndices<typename MakeKeyIndices<N / 2>::Type
+			, typename MakeKeyIndices<N - N / 2>::Type>::Type Type;
+};
+template<> struct MakeKeyIndices<0> { typedef KeyIndices<> Type; };
+template<> struct MakeKeyIndices<1> { typedef KeyIndices<0> Type; };
+
+template<typename K, int I> struct KeyOffset {	// of key I in K::keys(), found from the offset of the previous key
+	enum { VALUE = static_cast<int>(KeyHash::next(K::keys() + KeyOffset<K, I - 1>::VALUE) - K::keys()) };
+};
+template<typename K> struct KeyOffset<K, 0> {
+	enum { VALUE = static_cast<int>(KeyHash::skipSeparators(K::keys()) - K::keys()) };
+};
+
+template<typename K, typename I> struct KeyHashes;
+template<typename K, int... I> struct KeyHashes< K, KeyIndices<I...> > {
+	static constexpr uint16_t OFFSETS[sizeof...(I)] = { static_cast<uint16_t>(KeyOffset<K, I>::VALUE)... };
+	static constexpr uint32_t HASHES[sizeof...(I)] = { KeyHash::ofKey(K::keys() + OFFSETS[I], KeyHash::BASIS)... };
+};
+template<typename K, int... I> constexpr uint16_t KeyHashes< K, KeyIndices<I...> >::OFFSETS[sizeof...(I)];
+template<typename K, int... I> constexpr uint32_t KeyHashes< K, KeyIndices<I...> >::HASHES[sizeof...(I)];
+
+template<typename K> class KeySet {
+	public:
+		enum { COUNT = KeyHash::count(KeyHash::skipSeparators(K::keys())) };
+		static_assert(COUNT > 0 && COUNT <= 64, "KeySet needs 1 to 64 keys");
+
+	protected:
+		typedef KeyHashes<K, typename MakeKeyIndices<COUNT>::Type> Keys;	// offsets and hashes by key index
+
+	public:
+		enum {
+			MASK = (!KeyHash::isUnique(Keys::HASHES, COUNT) ? 0	// no seed can separate keys with the same hash
+					: KeyHash::findMask(Keys::HASHES, COUNT, KeyHash::minimumMask(COUNT, 1), KeyHash::MASK_DOUBLINGS))
+			, ATTEMPT = KeyHash::findSeed(Keys::HASHES, COUNT, MASK, 0, KeyHash::SEEDS)
+		};
+		static_assert(MASK != 0, "KeySet has duplicate keys (or no perfect hash was found)");
+		static int find(const Char* key, size_t length);	// index of `key` in K::keys() or -1
+		static int find(const StringView& key) { return find(key.data(), key.size()); }
+		static int find(const String& key) { return find(key.data(), key.size()); }
+		static int find(const Char* key) { return find(key, std::char_traits<Char>::length(key)); }
+
+	protected:
+		template<typename S, typename I> struct Tables;
+		template<int... S, int... I> struct Tables< KeyIndices<S...>, KeyIndices<I...> > {
+			static constexpr uint16_t KEY_SLOTS[sizeof...(I)]	// slot by key index
+					= { static_cast<uint16_t>(KeyHash::slotOf(Keys::HASHES[I], KeyHash::seed(ATTEMPT), MASK))... };
+			static constexpr int8_t SLOTS[sizeof...(S)]	// key index by hash & MASK, -1 for empty slots
+					= { static_cast<int8_t>(KeyHash::indexOf(KEY_SLOTS, COUNT, S, 0))... };
+		};
+		typedef Tables<typename MakeKeyIndices<MASK + 1>::Type, typename MakeKeyIndices<COUNT>::Type> SlotTables;
+};
+
+template<typename K> template<int... S, int... I> constexpr uint16_t
+		KeySet<K>::Tables< KeyIndices<S...>, KeyIndices<I...> >::KEY_SLOTS[sizeof...(I)];
+template<typename K> template<int... S, int... I> constexpr int8_t
+		KeySet<K>::Tables< KeyIndices<S...>, KeyIndices<I...> >::SLOTS[sizeof...(S)];
+
+template<typename K> int KeySet<K>::find(const Char* key, size_t length) {
+	const int index = SlotTables::SLOTS[KeyHash::of(key, length, KeyHash::seed(ATTEMPT)) & MASK];
+	if (index < 0) {
+		return -1;
+	}
+	const Char* name = K::keys() + Keys::OFFSETS[index];
+	size_t i = 0;
+	while (i < length && key[i] == name[i] && name[i] != 0 && !KeyHash::isSeparator(name[i])) {
+		++i;
+	}
+	return (i == length && (name[i] == 0 || KeyHash::isSeparator(name[i])) ? index : -1);
+}
+
+/**
+	The members of a struct parsed by KeySet<K> index. Elements of missing keys are undefined (see Element::exists()).
+**/
+template<typename K> class KeySlots {
+	public:
+		enum { COUNT = KeySet<K>::COUNT };
+		Element& operator[](size_t index) { assert(index < COUNT); return elements[index]; }
+		const Element& operator[](size_t index) const { assert(index < COUNT); return elements[index]; }
+		size_t size() const { return COUNT; }
+
+	protected:
+		Element elements[COUNT];
+};
+
 class Parser {
 	friend bool unitTest();
 	
@@ -151,6 +706,12 @@ class Parser {
 		bool tryToParse(WideStruct& toWideStruct);	// expects '{ : }' wide struct; false on failure
 		bool tryToParse(String& toString);	// expects quoted or unquoted string; false on failure
 		bool tryToParse(WideString& toString);	// expects quoted string; false on failure
+		bool tryToParse(StringView& toView);	// expects quoted or unquoted string; false on failure
+		bool tryToParse(ViewStruct& toViewStruct);	// expects '{ : }' struct; false on failure
+		bool tryToParse(FlatStruct& toFlatStruct);	// expects '{ : }' struct; false on failure
+		bool tryToParse(WideFlatStruct& toWideFlatStruct);	// expects '{ : }' wide struct; false on failure
+		bool tryToParse(HashStruct& toHashStruct);	// expects '{ : }' struct; false on failure
+		bool tryToParse(WideHashStruct& toWideHashStruct);	// expects '{ : }' wide struct; false on failure
 		bool tryToParse(float& toFloat);	// expects real number; false on failure
 		bool tryToParse(double& toDouble);	// expects real number; false on failure
 		bool tryToParse(int8_t& toInt);	// expects signed integer; false on failure
@@ -163,30 +724,84 @@ class Parser {
 		bool tryToParse(uint64_t& toInt);	// expects unsigned integer; false on failure
 		bool tryToParse(bool& toBool);	// expects `true` or `false`; false on failure
 		bool tryToParse(Variant& toVariant);	// expects any element; false on failure
+		bool tryToParse(Document& toDocument);	// expects any element, resolves all nested elements; false on failure
 		template<typename T> bool tryToParse(std::vector<T>& toVector);	// expects '{ }' array; false on failure
+		// Vectors of numbers take a faster path (see NumberListParser) with the same results and fail points.
+		bool tryToParse(std::vector<float>& toVector);
+		bool tryToParse(std::vector<double>& toVector);
+		bool tryToParse(std::vector<int8_t>& toVector);
+		bool tryToParse(std::vector<uint8_t>& toVector);
+		bool tryToParse(std::vector<int16_t>& toVector);
+		bool tryToParse(std::vector<uint16_t>& toVector);
+		bool tryToParse(std::vector<int32_t>& toVector);
+		bool tryToParse(std::vector<uint32_t>& toVector);
+		bool tryToParse(std::vector<int64_t>& toVector);
+		bool tryToParse(std::vector<uint64_t>& toVector);
 		template<typename T> bool tryToParse(std::map<String, T>& toMap);	// expects '{ : }' struct; false on failure
 		template<typename T> bool tryToParse(std::map<WideString, T>& toMap);	// expects '{ : }' wide struct; false on failure
 		template<typename T> bool tryToParse(T& to, size_t& failOffset);	// sets `failOffset` on error; false on failure
+		// expects '{ : }' struct with the keys of NUMBSTRICT_FIELDS; false on failure
+		template<typename T> typename std::enable_if<Fields<T>::BOUND != 0, bool>::type tryToParse(T& toFields);
+		template<typename K> bool tryToParse(KeySlots<K>& toSlots);	// expects '{ : }' struct with K keys; false if fail
 		template<typename T> T& parse(T& to);
 
 	protected:
 		const Element source;
 		StringIt p;
+		StringIt e;
 		template<typename T> bool tryToParseSignedInt(T& i);
 		template<typename T> bool tryToParseUnsignedInt(T& ui);
 		template<typename T> bool tryToParseReal(T& r);
+		template<typename T> bool signedInt(T& i);
+		template<typename T> bool unsignedInt(T& ui);
+		template<typename T> bool real(T& r);
+		template<typename T> bool tryToParseElements(std::vector<T>& toVector);
+		template<typename T> bool tryToParseNumbers(std::vector<T>& toVector);
+		template<typename T> bool number(T& n, std::true_type isReal);
+		template<typename T> bool number(T& n, std::false_type isReal);
+		template<typename T> bool plainNumber(T& n);
+		template<typename T> class FieldValueParser;
+		template<typename K> class SlotValueParser;
+		template<typename K, typename V> bool tryToParseKeys(V& values);
+		bool openFields(bool& braced);
+		bool fieldKey(StringView& key);
+		bool skipFieldValue(StringIt keyBegin);
+		bool closeFields(bool braced);
+		template<typename T> bool fieldValue(T& to);
+		template<typename T> bool fieldNumber(T& to);
+		bool fieldValue(float& to);
+		bool fieldValue(double& to);
+		bool fieldValue(int8_t& to);
+		bool fieldValue(uint8_t& to);
+		bool fieldValue(int16_t& to);
+		bool fieldValue(uint16_t& to);
+		bool fieldValue(int32_t& to);
+		bool fieldValue(uint32_t& to);
+		bool fieldValue(int64_t& to);
+		bool fieldValue(uint64_t& to);
 		template<typename C> bool quotedString(std::basic_string<C>& string);
 		template<typename C> void unquotedText(std::basic_string<C>& string);
 		template<typename C> bool stringOrText(std::basic_string<C>& string);
+		bool quotedString(StringView& view);
 		bool valueListElements(Array& elements);
-		template<typename C> bool keyValuePair(std::map<std::basic_string<C>, Element>& elements);
-		template<typename C> bool keyValueElements(std::map<std::basic_string<C>, Element>& elements);
+		template<typename S> bool keyValuePair(S& elements);
+		template<typename S> bool keyValueElements(S& elements);
 		template<typename S> bool tryToParseStruct(S& elements);
+		template<typename K> bool tryToParseFlatStruct(BasicFlatStruct<K>& elements);
 		bool parseIdentifier(String& identifier);
-		bool blockElement(Element& block);
+		bool parseKey(String& key);
+		bool parseKey(WideString& key);
+		bool parseKey(StringView& key);
+		Variant::Type classifyNumber(int64_t& toInteger, uint64_t& toUnsignedInteger, double& toReal);
+		bool isStructBlock();
+		bool isKeyValueList();
+		bool lookAheadKeyValueList();
+		bool skipBlock();
+		bool skipValue(StringIt& end);
 		bool valueElement(Element& Element);
-		bool quotedStringElement(Element& Element);
-		bool unquotedTextElement(Element& Element);
+		bool skipQuotedString();
+		bool skipIndexed(bool& ok);
+		StringIt skipUnquotedText();
 		bool nextElement();
 		bool horizontalWhiteAndComments();
 		bool whiteAndComments();
@@ -211,6 +826,83 @@ template<typename T> T& Parser::parse(T& to) {
 	return to;
 }
 
+// Parses the value of field `index` straight into its member. Visitor for Fields<T>::visit(visitor, index).
+template<typename T> class Parser::FieldValueParser {
+	public:
+		FieldValueParser(Parser& parser, T& object) : parser(parser), object(object) { }
+		bool operator()(int index) { return Fields<T>::visit(*this, index); }
+		template<typename M> bool operator()(const char*, M T::*member) { return parser.fieldValue(object.*member); }
+		Parser& parser;
+		T& object;
+};
+
+template<typename K> class Parser::SlotValueParser {
+	public:
+		SlotValueParser(Parser& parser, KeySlots<K>& slots) : parser(parser), slots(slots) { }
+		bool operator()(int index) { return parser.valueElement(slots[index]); }
+		Parser& parser;
+		KeySlots<K>& slots;
+};
+
+/*
+	Follows tryToParseStruct() and keyValuePair() step by step, so syntax errors and duplicate keys fail at the same
+	points. Keys that are not in KeySet<K> fail like duplicates, at the key. `values(index)` parses the value at `p`.
+*/
+template<typename K, typename V> bool Parser::tryToParseKeys(V& values) {
+	bool braced;
+	const bool hasKeys = openFields(braced);
+	bool parsed[KeySet<K>::COUNT] = { };
+	while (hasKeys && !eof() && *p != '}') {
+		const StringIt keyBegin = p;
+		StringView key;
+		if (!fieldKey(key)) {
+			return false;
+		}
+		const int index = KeySet<K>::find(key);
+		if (index < 0 || parsed[index]) {
+			return skipFieldValue(keyBegin);
+		}
+		parsed[index] = true;
+		if (!values(index)) {
+			return false;
+		}
+		horizontalWhiteAndComments();
+		if (!nextElement()) {
+			return false;
+		}
+	}
+	return closeFields(braced);
+}
+
+template<typename T> typename std::enable_if<Fields<T>::BOUND != 0, bool>::type Parser::tryToParse(T& toFields) {
+	FieldValueParser<T> values(*this, toFields);
+	return tryToParseKeys< Fields<T> >(values);
+}
+
+template<typename K> bool Parser::tryToParse(KeySlots<K>& toSlots) {
+	toSlots = KeySlots<K>();
+	SlotValueParser<K> values(*this, toSlots);
+	return tryToParseKeys<K>(values);
+}
+
+/*
+	Parses the value at `p` into `to` with this parser, limited to the end of the value (like Parser(valueElement())
+	would, without building an Element and a new Parser).
+*/
+template<typename T> bool Parser::fieldValue(T& to) {
+	const StringIt b = p;
+	StringIt end;
+	if (!skipValue(end)) {
+		return false;
+	}
+	const StringIt limit = e;
+	p = b;
+	e = end;
+	const bool ok = tryToParse(to);
+	e = limit;
+	return ok;
+}
+
 template<typename T> T Element::to() const {
 	if (!exists()) {
 		throw UndefinedElementError();
@@ -235,7 +927,58 @@ template<typename T> bool Element::tryToParse(T& target) const { // expects conv
 	return Parser(*this).tryToParse(target);
 }
 
+/**
+	A Cursor navigates an Element lazily, e.g. `element["a"]["b"][3].to<double>()`, without parsing any containers.
+	Members are found by skipping over the siblings before them with the same skipping as the Parser (so a
+	StructuralIndex helps here too). Siblings after the requested member are not even looked at, so they are not
+	validated and duplicate keys are not detected.
+
+	A Cursor remembers the members it has scanned so far (copies share this), so looking up more members of the same
+	Cursor continues where the last lookup ended. Hold on to the Cursor of a parent that you access repeatedly. Indexing
+	a struct by position gives its members in source order. Missing keys and indices give a Cursor that does not
+	exist (and throws UndefinedElementError on to<type>()). Syntax errors found while scanning throw ParsingError.
+	Cursors are not thread-safe, not even const ones.
+**/
+class Cursor {
+	friend class MemberParser;
+
+	public:
+		Cursor() { }
+		explicit Cursor(const Element& element) : code(element), members(std::make_shared<Members>()) { }
+		bool exists() const { return code.exists(); }
+		Cursor operator[](size_t i) const;				// struct member or array element by position
+		Cursor operator[](const String& key) const;		// struct member by key (!exists() if not found)
+		Cursor operator[](const Char* key) const { return (*this)[String(key)]; }
+		size_t size() const;							// number of members or elements (scans all of them)
+		Element element() const { return code; }
+		template<typename T> T to() const { return code.template to<T>(); }
+		template<typename T> T toOptional(const T& defaultValue = T()) const {
+			return code.template toOptional<T>(defaultValue);
+		}
+
+	protected:
+		struct Members {
+			typedef StringView key_type;
+			Members() : started(false), braced(false), isStruct(false), complete(false) { }
+			std::pair<size_t, bool> insert(std::pair<StringView, Element>&& member);	// for Parser::keyValuePair()
+			bool started;
+			bool braced;
+			bool isStruct;
+			bool complete;
+			StringIt next;					// where scanning continues
+			std::vector<StringView> keys;	// empty for arrays
+			std::vector<Element> values;
+		};
+		bool scanned(size_t i) const;		// scans until member `i` is found or all are scanned
+		Element code;
+		std::shared_ptr<Members> members;
+};
+
 template<typename T> bool Parser::tryToParse(std::vector<T>& toVector) { // expects '{ }' array; false on failure
+	return tryToParseElements(toVector);
+}
+
+template<typename T> bool Parser::tryToParseElements(std::vector<T>& toVector) {
 	Array elems;
 	if (!tryToParse(elems)) {
 		return false;
@@ -272,6 +1015,286 @@ template<typename T> bool Parser::tryToParse(std::map<WideString, T>& toMap) { /
 	return true;
 }
 
+/**
+	An Arena is a bump allocator that hands out memory from large blocks. Blocks grow geometrically, so the number of
+	heap allocations is logarithmic in the total size. Nothing is released individually; everything is freed at once by
+	clear() or on destruction. clear() merges all blocks into one that can hold everything that was allocated, so that
+	refilling the Arena with data of similar size does not allocate at all. Destructors are never called, so only use it
+	for trivially destructible types.
+**/
+class Arena {
+	public:
+		Arena() : last(0), next(0), left(0), allocationCount(0) { }
+		~Arena();
+		void* allocate(size_t size);
+		template<typename T> T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof (T))); }
+		void clear();
+		size_t getAllocationCount() const { return allocationCount; }	// total number of heap allocations made
+
+	protected:
+		struct Block {
+			Block* previous;
+			size_t size;
+		};
+		Arena(const Arena&);				// non-copyable
+		Arena& operator=(const Arena&);
+		Block* last;
+		char* next;
+		size_t left;
+		size_t allocationCount;
+};
+
+/**
+	A Document is the result of parsing an entire source in a single pass. Unlike Struct and Array, which hold unparsed
+	Elements that are re-scanned by every to<type>(), a Document resolves all nested values immediately into a compact
+	tree of typed nodes. Types are deduced the same way as for Variant and struct members are ordered by key, just like
+	in a WideStruct. The root may also be a key/value list without braces, which is parsed into a struct node like
+	Parser::tryToParse(Struct&) parses it.
+
+	Navigate the tree from root() with Node::operator[] and use Node::to<type>() to read values. Booleans, integers of
+	all sizes, floats, doubles and texts are read straight from the resolved nodes when that gives what parsing the
+	source gives. Other types, and values that don't fit (e.g. 300 as an int8_t), are parsed from the source, so you get
+	the same results and ParsingErrors as from Element::to<type>(). Nodes also remember their source range, so
+	Node::element() gives you back the Element of any node, e.g. for error reporting.
+
+	All nodes, keys and decoded texts live in a single Arena owned by the Document (copies share the same Arena). Nodes
+	only store source offsets, so there is no reference counting per node. Node objects point to their Document and are
+	invalidated when the Document is destroyed or reassigned. Parsing into an existing Document reuses its Arena.
+**/
+class Document {
+	friend class DocumentParser;
+
+	protected:
+		struct NodeData;
+
+	public:
+		class Node {
+			friend class Document;
+
+			public:
+				Node() : document(0), data(0) { }
+				bool exists() const { return data != 0; }
+				Variant::Type type() const;									// INVALID if !exists()
+				size_t size() const;										// number of members or elements (0 for scalars)
+				Node operator[](size_t i) const;							// struct member or array element by position
+				Node operator[](const String& key) const;					// struct member by key (!exists() if not found)
+				Node operator[](const WideString& key) const;				// struct member by key (!exists() if not found)
+				Node operator[](const Char* key) const { return (*this)[String(key)]; }
+				WideString key() const;										// key of struct member, empty for other nodes
+				StringIt begin() const;										// source iterators, like Element::begin()
+				StringIt end() const;
+				Element element() const;									// source range of this node
+				template<typename T> T to() const;
+				template<typename T> T toOptional(const T& defaultValue = T()) const;
+
+			protected:
+				Node(const Document* document, const NodeData* data) : document(document), data(data) { }
+				template<typename C> Node find(const std::basic_string<C>& key) const;
+				bool resolved(bool& v) const;
+				bool resolved(int8_t& v) const;
+				bool resolved(uint8_t& v) const;
+				bool resolved(int16_t& v) const;
+				bool resolved(uint16_t& v) const;
+				bool resolved(int32_t& v) const;
+				bool resolved(uint32_t& v) const;
+				bool resolved(int64_t& v) const;
+				bool resolved(uint64_t& v) const;
+				bool resolved(float& v) const;
+				bool resolved(double& v) const;
+				bool resolved(String& v) const;
+				bool resolved(WideString& v) const;
+				template<typename T> bool resolved(T&) const { return false; }		// not resolved, parse from source
+				template<typename T> bool resolvedSignedInt(T& v) const;
+				template<typename T> bool resolvedUnsignedInt(T& v) const;
+				const Document* document;
+				const NodeData* data;
+		};
+
+		Document() : rootData(0) { }
+		bool exists() const { return rootData != 0; }
+		Node root() const { return Node(this, rootData); }
+		Element source() const { return code; }
+		const Arena* getArena() const { return arena.get(); }
+
+	protected:
+		struct NodeData {
+			Variant::Type type;
+			size_t begin;				// source offset (relative to code.begin())
+			size_t end;
+			const WideChar* key;		// key of struct member
+			size_t keyLength;
+			union {
+				const NodeData* children;	// STRUCT and ARRAY
+				const WideChar* text;		// TEXT
+			};
+			size_t count;				// number of children or characters
+			union {
+				double real;
+				int64_t integer;
+				uint64_t unsignedInteger;
+				bool boolean;
+			};
+		};
+		Element code;
+		std::shared_ptr<Arena> arena;
+		const NodeData* rootData;
+};
+
+template<typename T> T Document::Node::to() const {
+	if (!exists()) {
+		throw UndefinedElementError();
+	}
+	T v;
+	if (!resolved(v)) {
+		v = element().template to<T>();
+	}
+	return v;
+}
+
+template<typename T> T Document::Node::toOptional(const T& defaultValue) const {
+	return (exists() ? to<T>() : defaultValue);
+}
+
+/**
+	A StreamHandler receives the events of a StreamParser. Override the ones you need. Each struct member is reported
+	as key() followed by the events of its value. Scalars are reported as unparsed Elements, so use to<type>() to
+	convert them (just like the Elements of a Struct or Array). They keep their part of the input alive.
+**/
+class StreamHandler {
+	public:
+		virtual void beginStruct() { }
+		virtual void endStruct() { }
+		virtual void beginArray() { }
+		virtual void endArray() { }
+		virtual void key(const WideString&) { }
+		virtual void scalar(const Element&) { }
+		virtual ~StreamHandler() { }
+};
+
+/**
+	A StreamParser parses input that arrives in chunks, e.g. a file too large to load at once, and reports it to a
+	StreamHandler as it goes. Chunks may be cut anywhere, also inside quoted strings and comments. Memory use does not
+	grow with the length of the input, only with the nesting depth, the longest single value and the keys of the open
+	structs (which are needed to detect duplicates).
+
+	The root is a block, a key/value list without braces (reported as a struct) or a single value. Blocks and key/value
+	lists are accepted exactly like Parser accepts them (e.g. with tryToParse(Struct&)) and fail at the same offsets.
+	A single root value is reported by finish(), and so is the end of a root list without braces. Other events are
+	reported as soon as the input they depend on has arrived, so the handler may receive events before a ParsingError
+	for later input.
+
+	Call feed() for each chunk and finish() at the end of input. Both throw ParsingError on invalid input, with offsets,
+	lines and columns counted from the beginning of the stream. The StreamParser can't be used after an error.
+**/
+class StreamParser {
+	friend class StreamChunkParser;
+
+	public:
+		StreamParser(StreamHandler& handler, const String& filename = String());
+		void feed(const Char* begin, const Char* end);
+		void feed(const String& chunk) { feed(chunk.data(), chunk.data() + chunk.size()); }
+		void finish();
+		size_t getDepth() const { return depth; }	// number of open blocks
+
+	protected:
+		struct Block {						// reused (with all its memory) by the next block at the same depth
+			Block() : isStruct(false), keyCount(0), keyOffset(0) { }
+			bool hasKey(const WideString& key) const;
+			void addKey(const WideString& key);
+			bool isStruct;
+			std::vector<WideString> keys;	// the first `keyCount` are the keys of the members so far (structs only)
+			size_t keyCount;
+			std::set<WideString> keyIndex;	// all keys, once there are too many to search linearly
+			WideString key;					// of this block in a parent struct
+			size_t keyOffset;
+			LineAndColumn keyLineAndColumn;
+		};
+		void parse();
+		StreamHandler& handler;
+		const String filename;
+		String pending;						// input that has not been parsed yet, beginning at `offset`
+		size_t offset;
+		LineAndColumn lineAndColumn;		// of `offset`
+		size_t retrySize;					// don't parse again before `pending` has grown to this size
+		bool started;
+		bool unbracedRoot;					// the root is a key/value list without braces, closed by finish()
+		bool finished;
+		std::vector<Block> blocks;			// the first `depth` are open
+		size_t depth;
+};
+
+void parseStream(std::istream& input, StreamHandler& handler, const String& filename = String());	// 64 KB chunks
+
+/**
+	Parses the top-level list of a large source (a struct or array, with or without braces, e.g. hundreds of thousands
+	of records) on several threads. A serial pre-scan (with the same SIMD scanning as StructuralIndex) splits the list
+	at top-level separators, the chunks are parsed on `threadCount` threads (0 = one per hardware thread) and the
+	results are merged. The result is the same as from to<type>(). On any error the source is parsed again serially, so
+	the ParsingError is the same too. Sources too small to give each thread at least PARALLEL_CHUNK_SIZE chars are
+	parsed on fewer threads.
+**/
+const size_t PARALLEL_CHUNK_SIZE = 64 * 1024;
+void parseParallel(const Element& source, Array& to, unsigned threadCount = 0);
+void parseParallel(const Element& source, Struct& to, unsigned threadCount = 0);
+void parseParallel(const Element& source, FlatStruct& to, unsigned threadCount = 0);
+
+/**
+	A Schema describes the expected shape of a source: types, ranges, allowed texts and required keys. The schema is
+	itself Numbstrict, e.g.
+
+		{
+			type: struct
+			members: {
+				name: text
+				size: { type: integer, min: 1, max: 100 }
+				ratio: { type: real, min: 0, max: 1, optional: true }
+				mode: { type: text, values: { fast, exact } }
+				tags: { type: array, elements: text, maxCount: 8 }
+				defines: { type: struct, otherMembers: text }
+			}
+		}
+
+	Types are `any`, `struct`, `array`, `text`, `real`, `integer` (64-bit signed) and `boolean`. A type name alone is
+	short for `{ type: name }`. Options are `min` / `max` (real and integer), `minLength` / `maxLength` and `values`
+	(text), `elements` / `minCount` / `maxCount` (array) and `members` / `otherMembers` (struct). Members are required
+	unless `optional: true`, and keys that are not members are errors unless there is an `otherMembers` schema.
+
+	The constructor compiles the schema into a table of nodes (and throws ParsingError or SchemaError for an invalid
+	schema). validate() then checks a source in a single pass, without building any Arrays, Structs or Variants, and
+	stops at the first invalid point in source order. Syntax errors throw ParsingError like to<T>() does, schema
+	mismatches throw SchemaError (a ParsingError) at the value (the key for unknown keys, the closing brace for missing
+	keys).
+**/
+class Schema {
+	friend class SchemaValidator;
+
+	public:
+		explicit Schema(const Element& schema);
+		void validate(const Element& source) const;	// throws ParsingError or SchemaError
+		bool tryToValidate(const Element& source, size_t& failOffset) const;	// sets `failOffset` on error
+
+	protected:
+		enum Type { ANY, STRUCT, ARRAY, TEXT, REAL, INTEGER, BOOLEAN };
+		static const size_t NONE = static_cast<size_t>(-1);
+		struct Node {
+			Node();
+			Type type;
+			bool optional;
+			int64_t minimumInteger;
+			int64_t maximumInteger;
+			double minimumReal;
+			double maximumReal;
+			size_t minimumSize;					// text length or element count
+			size_t maximumSize;
+			std::vector<String> values;			// allowed texts (any if empty)
+			std::vector< std::pair<String, size_t> > members;	// node index by key, sorted by key
+			size_t elements;					// node index for array elements
+			size_t otherMembers;				// node index for keys that are not in `members`, or NONE
+		};
+		size_t compile(const Element& schema);
+		std::vector<Node> nodes;			// the first one is the root
+};
+
 inline std::basic_ostream<Char>& operator<<(std::basic_ostream<Char>& o, const Element& s) {
 	o << s.to<String>();
 	return o;
@@ -300,8 +1323,43 @@ String compose(const WideString& fromString, bool preferUnquoted = false);
 String compose(const Array& array, bool multiLine = false, bool bracket = true);
 String compose(const Struct& structure, bool multiLine = false, bool bracket = true);
 String compose(const WideStruct& structure, bool multiLine = false, bool bracket = true);
+String compose(const FlatStruct& structure, bool multiLine = false, bool bracket = true);
+String compose(const WideFlatStruct& structure, bool multiLine = false, bool bracket = true);
+String compose(const HashStruct& structure, bool multiLine = false, bool bracket = true);
+String compose(const WideHashStruct& structure, bool multiLine = false, bool bracket = true);
 String compose(const Variant& variant);
 
+/**
+	Same output as compose() for the same arguments, but elements or members are composed in chunks on `threadCount`
+	threads (0 = one per hardware thread) into separate Strings that are concatenated once at the end. Containers with
+	fewer than 2048 elements are composed serially.
+**/
+String composeParallel(const Array& array, bool multiLine = false, bool bracket = true, unsigned threadCount = 0);
+String composeParallel(const Struct& structure, bool multiLine = false, bool bracket = true, unsigned threadCount = 0);
+String composeParallel(const WideStruct& structure, bool multiLine = false, bool bracket = true, unsigned threadCount = 0);
+String composeParallel(const FlatStruct& structure, bool multiLine = false, bool bracket = true, unsigned threadCount = 0);
+String composeParallel(const WideFlatStruct& structure, bool multiLine = false, bool bracket = true
+		, unsigned threadCount = 0);
+String composeParallel(const HashStruct& structure, bool multiLine = false, bool bracket = true, unsigned threadCount = 0);
+String composeParallel(const WideHashStruct& structure, bool multiLine = false, bool bracket = true
+		, unsigned threadCount = 0);
+
+// Structs bound with NUMBSTRICT_FIELDS. Same layout as compose(const Struct&), but the members are in field order.
+template<typename T> typename std::enable_if<Fields<T>::BOUND != 0, String>::type compose(const T& fromFields
+		, bool multiLine = false, bool bracket = true);
+
+// Vectors of numbers are written straight into the output, without an Element per number. Same output as the template.
+String compose(const std::vector<float>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<double>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<int8_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<uint8_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<int16_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<uint16_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<int32_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<uint32_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<int64_t>& vector, bool multiLine = false, bool bracket = true);
+String compose(const std::vector<uint64_t>& vector, bool multiLine = false, bool bracket = true);
+
 template<typename T> String compose(const std::vector<T>& vector, bool multiLine = false, bool bracket = true) {
 	Array elems;
 	elems.reserve(vector.size());
@@ -319,6 +1377,147 @@ template<typename T> String compose(const std::map<String, T>& map, bool multiLi
 	return compose(elems, multiLine, bracket);
 }
 
+// Appends the members of a NUMBSTRICT_FIELDS struct like compose(const Struct&) does.
+class FieldComposer {
+	public:
+		FieldComposer(String& string, bool multiLine, bool bracket);
+		void field(const char* key, const String& code);
+		void finish();
+
+	protected:
+		String& string;
+		const bool multiLine;
+		const bool bracket;
+		bool first;
+};
+
+// Composes each field of `object`. Visitor for Fields<T>::visit().
+template<typename T> class FieldComposeVisitor {
+	public:
+		FieldComposeVisitor(FieldComposer& composer, const T& object) : composer(composer), object(object) { }
+		template<typename M> void operator()(const char* name, M T::*member) {
+			composer.field(name, compose(object.*member));
+		}
+		FieldComposer& composer;
+		const T& object;
+};
+
+template<typename T> typename std::enable_if<Fields<T>::BOUND != 0, String>::type compose(const T& fromFields
+		, bool multiLine, bool bracket) {
+	String string;
+	FieldComposer composer(string, multiLine, bracket);
+	FieldComposeVisitor<T> visitor(composer, fromFields);
+	Fields<T>::visit(visitor);
+	composer.finish();
+	return string;
+}
+
+/**
+	A ComposeSink receives the output of a Composer in pieces. Sinks don't throw on write errors: check the stream or
+	FILE* state, or BufferSink::overflowed(), when done.
+**/
+class ComposeSink {
+	public:
+		virtual void write(const Char* begin, const Char* end) = 0;
+		virtual ~ComposeSink() { }
+};
+
+class OStreamSink : public ComposeSink {
+	public:
+		explicit OStreamSink(std::basic_ostream<Char>& stream) : stream(stream) { }
+		virtual void write(const Char* begin, const Char* end);
+
+	protected:
+		std::basic_ostream<Char>& stream;
+};
+
+class FileSink : public ComposeSink {
+	public:
+		explicit FileSink(FILE* file) : file(file) { }
+		virtual void write(const Char* begin, const Char* end);
+
+	protected:
+		FILE* const file;
+};
+
+// Writes into a fixed buffer (not zero-terminated). size() counts all chars written, also those that did not fit.
+class BufferSink : public ComposeSink {
+	public:
+		BufferSink(Char* buffer, size_t capacity) : buffer(buffer), capacity(capacity), count(0) { }
+		virtual void write(const Char* begin, const Char* end);
+		size_t size() const { return count; }
+		bool overflowed() const { return count > capacity; }
+
+	protected:
+		Char* const buffer;
+		const size_t capacity;
+		size_t count;
+};
+
+class CallbackSink : public ComposeSink {
+	public:
+		typedef std::function<void (const Char* chars, size_t count)> Callback;
+		explicit CallbackSink(const Callback& callback) : callback(callback) { }
+		virtual void write(const Char* begin, const Char* end) { callback(begin, end - begin); }
+
+	protected:
+		const Callback callback;
+};
+
+/**
+	A Composer writes Numbstrict straight to a ComposeSink, e.g. for serializing more data than fits in memory. Memory
+	use is a fixed buffer plus the nesting depth. The output is exactly what nested compose() calls with the same
+	`multiLine` would give, e.g.
+
+		composer.beginStruct().key("size").value(3).key("tags").beginArray().value("a").value("b").endArray()
+				.endStruct();
+
+	gives "{ size: 3, tags: { \"a\", \"b\" } }". value() takes anything compose() takes, and value(const Element&)
+	writes the Element code as is (reindented like compose() does), e.g. a pre-composed member. A single value() without
+	beginStruct() / beginArray() is also a complete output. Call flush() at the end (the destructor also flushes but
+	can't report exceptions thrown by the sink).
+**/
+class Composer {
+	public:
+		Composer(ComposeSink& sink, bool multiLine = false);
+		~Composer();
+		Composer& beginStruct();
+		Composer& endStruct();
+		Composer& beginArray();
+		Composer& endArray();
+		Composer& key(const String& key);
+		Composer& key(const WideString& key);
+		Composer& value(const Element& element);
+		Composer& value(double value);
+		Composer& value(float value);
+		Composer& value(int value);
+		template<typename T> Composer& value(const T& value) {
+			const String composed = compose(value);
+			return code(composed.data(), composed.data() + composed.size(), false);
+		}
+		size_t depth() const { return levels.size(); }
+		void flush();
+
+	protected:
+		enum { BUFFER_SIZE = 64 * 1024 };
+		struct Level {
+			bool isStruct;
+			bool keyed;			// key written, value expected
+			size_t count;
+			bool lastEmpty;		// last array element had empty code (so it needs a trailing comma)
+		};
+		Composer& code(StringIt begin, StringIt end, bool isEmpty);
+		void beginValue(bool isEmpty);
+		void append(const Char* begin, const Char* end);
+		void append(const Char* chars) { append(chars, chars + std::char_traits<Char>::length(chars)); }
+		void appendTabs(size_t count);
+		void appendKey(const String& key);
+		ComposeSink& sink;
+		const bool multiLine;
+		std::vector<Level> levels;
+		String buffer;
+};
+
 // Functional interface. Same as element.to<type>() etc, so just a matter of taste.
 
 template<typename T> T parseRequired(const Element& source) { return source.to<T>(); }
@@ -335,6 +1534,44 @@ inline WideStruct parseWideStruct(const String& code, const String& filename = S
 inline WideStruct parseWideStruct(const Element& source) { return source.to<WideStruct>(); }
 inline Variant parseVariant(const String& code, const String& filename = String()) { return Element(code, filename).to<Variant>(); }
 inline Variant parseVariant(const Element& source) { return source.to<Variant>(); }
+inline Document parseDocument(const String& code, const String& filename = String()) { return Element(code, filename).to<Document>(); }
+inline Document parseDocument(const Element& source) { return source.to<Document>(); }
+
+/**
+	Parses a '{ }' array of numbers straight into caller memory, e.g. a preallocated buffer. Returns the number of
+	elements but writes only the first `capacity` of them, so call again with a larger buffer if the result is greater
+	than `capacity`. Fails like to< std::vector<T> >() (throws ParsingError or UndefinedElementError), and then `to` may
+	already hold some of the elements.
+**/
+size_t parseNumbers(const Element& source, float* to, size_t capacity);
+size_t parseNumbers(const Element& source, double* to, size_t capacity);
+size_t parseNumbers(const Element& source, int8_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, uint8_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, int16_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, uint16_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, int32_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, uint32_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, int64_t* to, size_t capacity);
+size_t parseNumbers(const Element& source, uint64_t* to, size_t capacity);
+
+/**
+	Real conversions (parsing and composing floats and doubles) that can't take the exact integer path run in the
+	standard floating-point environment, which is normally set up and restored around each such conversion. Holding a
+	RealConversionScope sets it up once for all conversions on the current thread until the scope ends, e.g. around
+	parsing or composing a large array of reals. Scopes nest; only the outermost one switches the environment. Don't
+	rely on the caller's own floating-point environment (rounding mode etc) while holding one.
+**/
+class RealConversionScope {
+	public:
+		RealConversionScope();
+		~RealConversionScope();
+
+	protected:
+		RealConversionScope(const RealConversionScope&);	// not copyable
+		RealConversionScope& operator=(const RealConversionScope&);
+		const bool outermost;
+		std::aligned_storage<64>::type environment;	// saved environment of the outermost scope (no heap allocation)
+};
 
 String intToString(int value);
 String intToHexString(unsigned int value, int minLength = 8);
@@ -363,4 +1600,78 @@ bool unitTest();
 
 } // namespace Numbstrict
 
+/**
+	NUMBSTRICT_FIELDS(Type, member, ...) binds members of a C++ struct to the keys of a Numbstrict struct with the same
+	names (up to 32 members), e.g.
+
+		struct Point { double x; double y; Numbstrict::String label; };
+		NUMBSTRICT_FIELDS(Point, x, y, label)
+
+	Then element.to<Point>(), to< std::vector<Point> >(), compose(point), composer.value(point) etc work with Points.
+	Parsing finds members with KeySet and writes each value straight into its member, without building a Struct. Keys
+	that are not fields are errors, like duplicate keys. Members without a key keep their value. Members can be of any
+	type that to<T>() and compose() take, including other bound structs. Use the macro at global scope (outside any
+	namespace).
+**/
+#define NUMBSTRICT_FIELDS(Type, ...) \
+	namespace Numbstrict { \
+	template<> struct Fields<Type> { \
+		enum { BOUND = 1, COUNT = NUMBSTRICT_COUNT(__VA_ARGS__) }; \
+		static constexpr const Char* keys() { return #__VA_ARGS__; } \
+		template<typename V> static void visit(V& visitor) { \
+			NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH(NUMBSTRICT_FIELD, Type, __VA_ARGS__)) \
+		} \
+		template<typename V> static bool visit(V& visitor, int index) { /* only field `index` (in KeySet order) */ \
+			switch (COUNT - index) { \
+				NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH(NUMBSTRICT_FIELD_CASE, Type, __VA_ARGS__)) \
+			} \
+			return false; \
+		} \
+	}; \
+	}
+
+#define NUMBSTRICT_FIELD(Type, member, remaining) visitor(#member, &Type::member);
+#define NUMBSTRICT_FIELD_CASE(Type, member, remaining) case remaining: return visitor(#member, &Type::member);
+#define NUMBSTRICT_EXPAND(x) x	// for MSVC, which passes __VA_ARGS__ on as a single argument otherwise
+#define NUMBSTRICT_CONCAT(a, b) NUMBSTRICT_CONCAT_(a, b)
+#define NUMBSTRICT_CONCAT_(a, b) a##b
+#define NUMBSTRICT_COUNT(...) NUMBSTRICT_EXPAND(NUMBSTRICT_COUNT_(__VA_ARGS__, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22 \
+		, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define NUMBSTRICT_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21 \
+		, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, n, ...) n
+#define NUMBSTRICT_FOR_EACH(m, t, ...) \
+		NUMBSTRICT_EXPAND(NUMBSTRICT_CONCAT(NUMBSTRICT_FOR_EACH_, NUMBSTRICT_COUNT(__VA_ARGS__))(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_1(m, t, a) m(t, a, 1)
+#define NUMBSTRICT_FOR_EACH_2(m, t, a, ...) m(t, a, 2) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_1(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_3(m, t, a, ...) m(t, a, 3) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_2(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_4(m, t, a, ...) m(t, a, 4) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_3(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_5(m, t, a, ...) m(t, a, 5) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_4(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_6(m, t, a, ...) m(t, a, 6) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_5(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_7(m, t, a, ...) m(t, a, 7) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_6(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_8(m, t, a, ...) m(t, a, 8) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_7(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_9(m, t, a, ...) m(t, a, 9) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_8(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_10(m, t, a, ...) m(t, a, 10) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_9(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_11(m, t, a, ...) m(t, a, 11) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_10(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_12(m, t, a, ...) m(t, a, 12) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_11(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_13(m, t, a, ...) m(t, a, 13) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_12(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_14(m, t, a, ...) m(t, a, 14) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_13(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_15(m, t, a, ...) m(t, a, 15) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_14(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_16(m, t, a, ...) m(t, a, 16) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_15(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_17(m, t, a, ...) m(t, a, 17) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_16(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_18(m, t, a, ...) m(t, a, 18) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_17(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_19(m, t, a, ...) m(t, a, 19) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_18(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_20(m, t, a, ...) m(t, a, 20) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_19(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_21(m, t, a, ...) m(t, a, 21) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_20(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_22(m, t, a, ...) m(t, a, 22) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_21(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_23(m, t, a, ...) m(t, a, 23) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_22(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_24(m, t, a, ...) m(t, a, 24) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_23(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_25(m, t, a, ...) m(t, a, 25) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_24(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_26(m, t, a, ...) m(t, a, 26) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_25(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_27(m, t, a, ...) m(t, a, 27) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_26(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_28(m, t, a, ...) m(t, a, 28) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_27(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_29(m, t, a, ...) m(t, a, 29) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_28(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_30(m, t, a, ...) m(t, a, 30) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_29(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_31(m, t, a, ...) m(t, a, 31) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_30(m, t, __VA_ARGS__))
+#define NUMBSTRICT_FOR_EACH_32(m, t, a, ...) m(t, a, 32) NUMBSTRICT_EXPAND(NUMBSTRICT_FOR_EACH_31(m, t, __VA_ARGS__))
+
 #endif /* Numbstrict_h */
@@ -6,6 +6,7 @@
 #include <istream>
 #include <ostream>
 #include <iterator>
+#include <sstream>
 #include <memory>
 #include <cstring>
 #include "Makaron.h"
@@ -19,19 +20,15 @@ const char SEPARATOR_CHARACTER = '/';
 std::vector<std::string> includePaths;
 
 static std::string loadEntireStream(std::istream& stream) {
-	std::istreambuf_iterator<Makaron::Char> it(stream);
-	std::istreambuf_iterator<Makaron::Char> end;
-	return std::string(it, end);
+	std::ostringstream contents;
+	contents << stream.rdbuf();
+	return contents.str();
 }
 
 
-static bool myIncludeLoader(const Makaron::WideString& fileName, Makaron::String& contents) {
-	std::string narrowFileName(fileName.begin(), fileName.end());
+static bool myIncludeLoader(const Makaron::WideString& fileName, Makaron::SourceBuffer& contents) {
 	for (std::vector<std::string>::const_iterator it = includePaths.begin(); it != includePaths.end(); ++it) {
-		std::ifstream fileStream(*it + narrowFileName);
-		if (fileStream.good()) {
-			fileStream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-			contents = loadEntireStream(fileStream);
+		if (Makaron::mapFile(*it + Makaron::String(fileName.begin(), fileName.end()), contents)) {
 			return true;
 		} else if (!fileName.empty() && fileName.front() == SEPARATOR_CHARACTER) { // only use empty path if leading /
 			assert(it->empty());
@@ -67,7 +64,7 @@ int main(int argc, const char* argv[]) {
 	try {
 		includePaths.push_back(std::string());
 		Makaron::Context context;
-		context.setIncludeLoader(myIncludeLoader);
+		context.setIncludeBufferLoader(myIncludeLoader);
 
 		std::string mapPath;
 		int argi = 1;
@@ -129,22 +126,19 @@ int main(int argc, const char* argv[]) {
 		}
 
 		std::vector<Makaron::OffsetMapEntry> offsetMap;
-		Makaron::String source;
+		Makaron::SourceBuffer source;
 		Makaron::String fileName;
 		Makaron::String processed;
 		try {
 			if (inputPath.empty() || inputPath == "-") {
-				source = loadEntireStream(std::cin);
+				source = Makaron::SourceBuffer(std::make_shared<const Makaron::String>(loadEntireStream(std::cin)));
 				fileName = "stdin";
 			} else {
-				std::ifstream fileStream(inputPath);
-				if (!fileStream.good()) {
+				if (!Makaron::mapFile(inputPath, source)) {
 					std::cerr << "Could not open input file" << std::endl;
 					return 1;
 				}
 				fileName = inputPath;
-				fileStream.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-				source = loadEntireStream(fileStream);
 			}
 			
 				context.process(Makaron::Span(source, Makaron::WideString(fileName.begin(), fileName.end())),
@@ -158,8 +152,9 @@ int main(int argc, const char* argv[]) {
 					<< std::endl
 					<< "Trace:" << std::endl;
 			Makaron::RangeVector inputRanges = findInputRanges(offsetMap, processed.size());
+			const Makaron::LineIndex lines(source.begin, source.end);
 			for (Makaron::RangeVector::const_iterator it = inputRanges.begin(); it != inputRanges.end(); ++it) {
-				std::pair<int, int> lineAndColumn = Makaron::calculateLineAndColumn(source, it->first);
+				std::pair<int, int> lineAndColumn = lines.find(it->first);
 				std::cerr << "Line: " << lineAndColumn.first << ", column: " << lineAndColumn.second;
 				if (it->second > it->first + 1) {
 					std::cerr << " (@" << it->first << ".." << it->second << ')' << std::endl;
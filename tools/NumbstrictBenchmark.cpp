@@ -0,0 +1,869 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <thread>
+#include "../src/Numbstrict.h"
+
+/*
+	Benchmarks for Numbstrict. Run without arguments to run all benchmarks or name the ones you want to run on the
+	command line. Build with tools/buildNumbstrictBenchmark.sh.
+*/
+
+static size_t allocationCount = 0;
+static size_t allocationBytes = 0;
+
+void* operator new(size_t size) {
+	++allocationCount;
+	allocationBytes += size;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == 0) {
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void operator delete(void* p) throw() {
+	free(p);
+}
+
+class Measurement {
+	public:
+		Measurement() : startAllocations(allocationCount), startBytes(allocationBytes)
+				, start(std::chrono::steady_clock::now()) { }
+		double milliseconds() const {
+			return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		size_t allocations() const { return allocationCount - startAllocations; }
+		size_t allocatedBytes() const { return allocationBytes - startBytes; }	// not counting frees
+
+	protected:
+		const size_t startAllocations;
+		const size_t startBytes;
+		const std::chrono::steady_clock::time_point start;
+};
+
+static void report(const char* what, const Measurement& measurement, size_t bytes = 0) {
+	const double ms = measurement.milliseconds();
+	std::cout << std::left << std::setw(44) << what << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(10) << ms << " ms" << std::setw(12) << measurement.allocations() << " allocations";
+	if (bytes != 0) {
+		std::cout << std::setw(10) << (bytes / (ms * 1000.0)) << " MB/s";
+	}
+	std::cout << std::endl;
+}
+
+static Numbstrict::String generateKeyValues(int count) {
+	Numbstrict::String source = "{\n";
+	for (int i = 0; i < count; ++i) {
+		source += "\tkey" + Numbstrict::intToString(i) + ": { name: \"item " + Numbstrict::intToString(i)
+				+ "\", value: " + Numbstrict::doubleToString(i * 0.25) + ", tags: { a, b, c } }\n";
+	}
+	return source + "}\n";
+}
+
+static void benchmarkAllocations() {
+	const Numbstrict::String source = generateKeyValues(50000);
+	const Numbstrict::Element element(source, "allocations");
+	{
+		Measurement measurement;
+		Numbstrict::Struct structure = element.to<Numbstrict::Struct>();
+		double sum = 0.0;
+		for (Numbstrict::Struct::const_iterator it = structure.begin(); it != structure.end(); ++it) {
+			const Numbstrict::Struct record = it->second.to<Numbstrict::Struct>();
+			record.find("name")->second.to<Numbstrict::WideString>();
+			sum += record.find("value")->second.to<double>();
+			record.find("tags")->second.to< std::vector<Numbstrict::WideString> >();
+		}
+		report("Struct, nested to<type>() of every value", measurement, source.size());
+	}
+	{
+		Measurement measurement;
+		Numbstrict::Document document = Numbstrict::parseDocument(element);
+		report("Document", measurement, source.size());
+	}
+	{
+		Numbstrict::Document document = Numbstrict::parseDocument(element);
+		Numbstrict::Parser(element).parse(document);
+		Measurement measurement;
+		Numbstrict::Parser(element).parse(document);
+		report("Document, reparsed (arena reused)", measurement, source.size());
+	}
+}
+
+template<typename S> static void parseStruct(const char* what, const Numbstrict::Element& element, size_t bytes) {
+	Measurement measurement;
+	S structure;
+	Numbstrict::Parser(element).parse(structure);
+	report(what, measurement, bytes);
+}
+
+static void benchmarkKeys() {
+	Numbstrict::String source;
+	for (int i = 0; i < 200000; ++i) {
+		source += "rendering_option_with_a_long_name_" + Numbstrict::intToString(i) + ": 'value'\n";
+	}
+	const Numbstrict::Element element(source, "keys");
+	parseStruct<Numbstrict::Struct>("Struct", element, source.size());
+	parseStruct<Numbstrict::WideStruct>("WideStruct", element, source.size());
+	parseStruct<Numbstrict::ViewStruct>("ViewStruct", element, source.size());
+}
+
+template<typename S> static void benchmarkContainer(const char* name, int keyCount, int repeats) {
+	Numbstrict::String source = "{\n";
+	std::vector<Numbstrict::String> keys;
+	for (int i = 0; i < keyCount; ++i) {
+		keys.push_back("option_" + Numbstrict::intToString((i * 7919) % keyCount));
+		source += "\t" + keys.back() + ": " + Numbstrict::intToString(i) + "\n";
+	}
+	source += "}\n";
+	const Numbstrict::Element element(source, "containers");
+	const Numbstrict::String prefix = Numbstrict::String(name) + " " + Numbstrict::intToString(keyCount) + " keys, ";
+	S structure;
+	{
+		Measurement measurement;
+		for (int i = 0; i < repeats; ++i) {
+			Numbstrict::Parser(element).parse(structure);
+		}
+		report((prefix + "parse").c_str(), measurement, source.size() * repeats);
+	}
+	{
+		Measurement measurement;
+		size_t found = 0;
+		for (int i = 0; i < repeats * 10; ++i) {
+			for (std::vector<Numbstrict::String>::const_iterator it = keys.begin(); it != keys.end(); ++it) {
+				found += (structure.find(*it) != structure.end() ? 1 : 0);
+			}
+		}
+		report((prefix + "lookup x10").c_str(), measurement);
+		if (found != keys.size() * repeats * 10) {
+			std::cout << "lookup failed" << std::endl;
+		}
+	}
+	{
+		Measurement measurement;
+		for (int i = 0; i < repeats; ++i) {
+			Numbstrict::compose(structure, true);
+		}
+		report((prefix + "compose").c_str(), measurement);
+	}
+}
+
+static void benchmarkContainers() {
+	benchmarkContainer<Numbstrict::Struct>("Struct", 20, 20000);
+	benchmarkContainer<Numbstrict::FlatStruct>("FlatStruct", 20, 20000);
+	benchmarkContainer<Numbstrict::HashStruct>("HashStruct", 20, 20000);
+	benchmarkContainer<Numbstrict::Struct>("Struct", 100000, 4);
+	benchmarkContainer<Numbstrict::FlatStruct>("FlatStruct", 100000, 4);
+	benchmarkContainer<Numbstrict::HashStruct>("HashStruct", 100000, 4);
+}
+
+static void benchmarkWhite() {
+	Numbstrict::String source = "{\n";
+	for (int i = 0; i < 20000; ++i) {
+		source += "\t\t\t\t\t\t/* generated record " + Numbstrict::intToString(i) + " */\n"
+				"\t\t\t\t\t\tkey" + Numbstrict::intToString(i) + ":                                    {\n"
+				"\t\t\t\t\t\t\t\t\t\tname:      item                  // the name\n"
+				"\t\t\t\t\t\t\t\t\t\tvalue:     " + Numbstrict::intToString(i) + "\n"
+				"\t\t\t\t\t\t\t\t\t\t/* disabled: { 1, 2, 3 } /* nested */ still disabled */\n"
+				"\t\t\t\t\t\t}\n";
+	}
+	source += "}\n";
+	const Numbstrict::Element element(source, "white");
+	const Numbstrict::String commented = "/*" + source + "*/";
+	{
+		Measurement measurement;
+		for (int i = 0; i < 10; ++i) {
+			Numbstrict::Parser(Numbstrict::Element(commented)).isEmpty();
+		}
+		report("entire file commented out", measurement, commented.size() * 10);
+	}
+	{
+		Measurement measurement;
+		Numbstrict::Document document;
+		for (int i = 0; i < 10; ++i) {
+			Numbstrict::Parser(element).parse(document);
+		}
+		report("Document", measurement, source.size() * 10);
+	}
+}
+
+static Numbstrict::String generateNested(int depth, int width) {
+	Numbstrict::String source = "{\n";
+	for (int i = 0; i < width; ++i) {
+		source += "\tname" + Numbstrict::intToString(i) + ": \"a string with a } in it\"\n";
+	}
+	source += "\tvalues: { 1, 2, 3, 4, 5, 6, 7, 8 } // a comment with a {\n";
+	if (depth > 0) {
+		source += "\tchild: " + generateNested(depth - 1, width) + "\n";
+	}
+	return source + "}";
+}
+
+static double walkNested(const Numbstrict::Element& element) {
+	const Numbstrict::Struct structure = element.to<Numbstrict::Struct>();
+	const Numbstrict::Struct::const_iterator child = structure.find("child");
+	return structure.size() + (child != structure.end() ? walkNested(child->second) : 0.0);
+}
+
+static void benchmarkIndex() {
+	const Numbstrict::String source = generateNested(200, 40);
+	{
+		Measurement measurement;
+		walkNested(Numbstrict::Element(source));
+		report("to<Struct>() level by level", measurement, source.size());
+	}
+	{
+		Measurement measurement;
+		const Numbstrict::Element element(source);
+		element.indexStructure();
+		report("build structural index", measurement, source.size());
+		walkNested(element);
+		report("to<Struct>() level by level, indexed", measurement, source.size());
+	}
+}
+
+static void benchmarkLazy() {
+	const Numbstrict::String source = generateNested(0, 100000);
+	const int ROUNDS = 10;
+	double sum = 0.0;
+	{
+		Measurement measurement;
+		for (int i = 0; i < ROUNDS; ++i) {
+			const Numbstrict::Struct structure = Numbstrict::Element(source).to<Numbstrict::Struct>();
+			sum += structure.find("name0")->second.code().size() + structure.find("name2")->second.code().size();
+		}
+		report("to<Struct>() for 2 leading keys", measurement, source.size() * ROUNDS);
+	}
+	{
+		Measurement measurement;
+		for (int i = 0; i < ROUNDS; ++i) {
+			const Numbstrict::Element element(source);
+			const Numbstrict::Cursor cursor(element);
+			sum += cursor["name0"].element().code().size() + cursor["name2"].element().code().size();
+		}
+		report("Cursor for 2 leading keys", measurement, source.size() * ROUNDS);
+	}
+	{
+		Measurement measurement;
+		for (int i = 0; i < ROUNDS; ++i) {
+			sum += Numbstrict::Element(source)["values"][7].to<double>();
+		}
+		report("Cursor for trailing key", measurement, source.size() * ROUNDS);
+	}
+	if (sum == 0.0) {
+		std::cout << "unexpected sum" << std::endl;
+	}
+}
+
+class CountingHandler : public Numbstrict::StreamHandler {
+	public:
+		CountingHandler() : count(0) { }
+		virtual void key(const Numbstrict::WideString&) { ++count; }
+		virtual void scalar(const Numbstrict::Element&) { ++count; }
+		size_t count;
+};
+
+static void benchmarkStream() {
+	Numbstrict::String source = "{\n";
+	for (int i = 0; i < 200000; ++i) {
+		source += "\t{ name: \"item " + Numbstrict::intToString(i) + "\", value: " + Numbstrict::doubleToString(i * 0.25)
+				+ ", tags: { a, b, c } } // record\n";
+	}
+	source += "}\n";
+	{
+		Measurement measurement;
+		Numbstrict::parseDocument(source);
+		report("Document", measurement, source.size());
+	}
+	{
+		Measurement measurement;
+		CountingHandler handler;
+		Numbstrict::StreamParser parser(handler);
+		const size_t CHUNK_SIZE = 64 * 1024;
+		for (size_t offset = 0; offset < source.size(); offset += CHUNK_SIZE) {
+			parser.feed(source.data() + offset, source.data() + std::min(offset + CHUNK_SIZE, source.size()));
+		}
+		parser.finish();
+		report("StreamParser, 64 KB chunks", measurement, source.size());
+	}
+}
+
+static void benchmarkLines() {
+	const Numbstrict::String source = generateKeyValues(100000);
+	const Numbstrict::Element element(source);
+	const size_t LOOKUPS = 200;
+	size_t sum = 0;
+	{
+		Measurement measurement;
+		for (size_t i = 0; i < LOOKUPS; ++i) {
+			const size_t offset = source.size() * i / LOOKUPS;
+			sum += std::count(source.begin(), source.begin() + offset, '\n');
+		}
+		report("count line feeds for each lookup", measurement);
+	}
+	{
+		Measurement measurement;
+		for (size_t i = 0; i < LOOKUPS; ++i) {
+			sum += element.lineAndColumn(element.begin() + source.size() * i / LOOKUPS).first;
+		}
+		report("Element::lineAndColumn() with LineIndex", measurement);
+	}
+	if (sum == 0) {
+		std::cout << "unexpected sum" << std::endl;
+	}
+}
+
+static std::vector<unsigned> threadCounts() {	// 1, 2, 4 ... up to the number of hardware threads
+	const unsigned cores = std::max(std::thread::hardware_concurrency(), 1U);
+	std::vector<unsigned> counts(1, 1);
+	while (counts.back() < cores) {
+		counts.push_back(std::min(counts.back() * 2, cores));
+	}
+	return counts;
+}
+
+static std::string threadSuffix(unsigned threads) {
+	return ", " + std::to_string(threads) + " thread" + (threads > 1 ? "s" : "");
+}
+
+static void benchmarkParallel() {
+	const Numbstrict::Element source(generateKeyValues(200000));
+	const size_t bytes = source.code().size();
+	{
+		Measurement measurement;
+		source.to<Numbstrict::Struct>();
+		report("to<Struct>()", measurement, bytes);
+	}
+	{
+		Measurement measurement;
+		source.to<Numbstrict::FlatStruct>();
+		report("to<FlatStruct>()", measurement, bytes);
+	}
+	const std::vector<unsigned> counts = threadCounts();
+	for (size_t i = 0; i < counts.size(); ++i) {
+		const unsigned threads = counts[i];
+		const std::string suffix = threadSuffix(threads);
+		{
+			Measurement measurement;
+			Numbstrict::Struct structure;
+			Numbstrict::parseParallel(source, structure, threads);
+			report(("parseParallel() Struct" + suffix).c_str(), measurement, bytes);
+		}
+		{
+			Measurement measurement;
+			Numbstrict::FlatStruct structure;
+			Numbstrict::parseParallel(source, structure, threads);
+			report(("parseParallel() FlatStruct" + suffix).c_str(), measurement, bytes);
+		}
+	}
+}
+
+static void benchmarkComposeParallel() {
+	const Numbstrict::Struct structure = Numbstrict::Element(generateKeyValues(200000)).to<Numbstrict::Struct>();
+	size_t bytes = 0;
+	{
+		Measurement measurement;
+		bytes = Numbstrict::compose(structure, true).size();
+		report("compose() Struct", measurement, bytes);
+	}
+	const std::vector<unsigned> counts = threadCounts();
+	for (size_t i = 0; i < counts.size(); ++i) {
+		Measurement measurement;
+		Numbstrict::composeParallel(structure, true, true, counts[i]);
+		report(("composeParallel() Struct" + threadSuffix(counts[i])).c_str(), measurement, bytes);
+	}
+}
+
+class CountingSink : public Numbstrict::ComposeSink {
+	public:
+		CountingSink() : count(0) { }
+		virtual void write(const Numbstrict::Char* begin, const Numbstrict::Char* end) { count += end - begin; }
+		size_t count;
+};
+
+static void benchmarkComposer() {
+	const int RECORDS = 200000;
+	size_t bytes = 0;
+	{
+		Measurement measurement;
+		Numbstrict::Struct records;
+		for (int i = 0; i < RECORDS; ++i) {
+			Numbstrict::Struct record;
+			record["name"] = Numbstrict::Element(Numbstrict::compose("item " + Numbstrict::intToString(i)));
+			record["value"] = Numbstrict::Element(Numbstrict::compose(i * 0.25));
+			Numbstrict::Array tags;
+			tags.push_back(Numbstrict::Element("a"));
+			tags.push_back(Numbstrict::Element("b"));
+			record["tags"] = Numbstrict::Element(Numbstrict::compose(tags, true));
+			records["key" + Numbstrict::intToString(i)] = Numbstrict::Element(Numbstrict::compose(record, true));
+		}
+		bytes = Numbstrict::compose(records, true).size();
+		report("nested compose(), multi-line", measurement, bytes);
+	}
+	{
+		Measurement measurement;
+		CountingSink sink;
+		Numbstrict::Composer composer(sink, true);
+		composer.beginStruct();
+		for (int i = 0; i < RECORDS; ++i) {
+			composer.key("key" + Numbstrict::intToString(i)).beginStruct();
+			composer.key("name").value("item " + Numbstrict::intToString(i)).key("value").value(i * 0.25);
+			composer.key("tags").beginArray().value(Numbstrict::Element("a")).value(Numbstrict::Element("b")).endArray();
+			composer.endStruct();
+		}
+		composer.endStruct().flush();
+		report("Composer, multi-line", measurement, sink.count);
+		if (sink.count == bytes) {
+			std::cout << "(same size)" << std::endl;
+		}
+	}
+}
+
+static void benchmarkReals() {
+	const int COUNT = 1000000;
+	std::vector<double> doubles;
+	std::vector<double> decimals;
+	std::vector<float> floats;
+	uint64_t random = 1;
+	for (int i = 0; i < COUNT; ++i) {
+		random = random * 6364136223846793005ULL + 1442695040888963407ULL;
+		doubles.push_back(std::ldexp(static_cast<double>(random >> 11), static_cast<int>(random % 200) - 150));
+		decimals.push_back(static_cast<double>(static_cast<int64_t>(random >> 40)) / 1000.0);
+		floats.push_back(static_cast<float>(doubles.back()));
+	}
+	Numbstrict::Char buffer[32];
+	size_t bytes = 0;
+	{
+		Measurement measurement;
+		for (int i = 0; i < COUNT; ++i) {
+			bytes += Numbstrict::doubleToChars(doubles[i], buffer) - buffer;
+		}
+		report("doubleToChars() 17 digits", measurement, bytes);
+	}
+	bytes = 0;
+	{
+		Measurement measurement;
+		for (int i = 0; i < COUNT; ++i) {
+			bytes += Numbstrict::doubleToChars(decimals[i], buffer) - buffer;
+		}
+		report("doubleToChars() 3 decimals", measurement, bytes);
+	}
+	bytes = 0;
+	{
+		Measurement measurement;
+		for (int i = 0; i < COUNT; ++i) {
+			bytes += Numbstrict::floatToChars(floats[i], buffer) - buffer;
+		}
+		report("floatToChars()", measurement, bytes);
+	}
+	Numbstrict::String text;
+	{
+		Measurement measurement;
+		text = Numbstrict::compose(decimals);
+		report("compose() std::vector<double>", measurement, text.size());
+	}
+	Numbstrict::String digits;
+	for (int i = 0; i < COUNT; ++i) {
+		digits.append(buffer, Numbstrict::doubleToChars(doubles[i], buffer));
+		digits += ' ';
+	}
+	{
+		Measurement measurement;
+		double sum = 0.0;
+		const Numbstrict::Char* end = digits.data() + digits.size();
+		for (const Numbstrict::Char* p = digits.data(); p < end; ++p) {
+			sum += Numbstrict::charsToDouble(p, end, &p);
+		}
+		report("charsToDouble() 17 digits", measurement, digits.size());
+		if (sum == 0.0) {
+			std::cout << "(zero sum)" << std::endl;
+		}
+	}
+	{
+		Measurement measurement;
+		const std::vector<double> parsed = Numbstrict::Element(text).to< std::vector<double> >();
+		report("to< std::vector<double> >() 3 decimals", measurement, text.size());
+	}
+	{
+		std::vector<double> parsed(COUNT);
+		Measurement measurement;
+		const size_t count = Numbstrict::parseNumbers(Numbstrict::Element(text), parsed.data(), parsed.size());
+		report("parseNumbers() 3 decimals", measurement, text.size());
+		if (count != decimals.size()) {
+			std::cout << "(wrong count)" << std::endl;
+		}
+	}
+	{
+		std::vector<int32_t> ints;
+		for (int i = 0; i < COUNT; ++i) {
+			ints.push_back(static_cast<int32_t>(decimals[i] * 1000.0));
+		}
+		const Numbstrict::String intText = Numbstrict::compose(ints);
+		Measurement measurement;
+		const std::vector<int32_t> parsed = Numbstrict::Element(intText).to< std::vector<int32_t> >();
+		report("to< std::vector<int32_t> >()", measurement, intText.size());
+	}
+	{
+		std::vector<int32_t> ints;
+		for (int i = 0; i < COUNT; ++i) {
+			ints.push_back(static_cast<int32_t>(decimals[i] * 1000.0));
+		}
+		Measurement measurement;
+		const Numbstrict::String intText = Numbstrict::compose(ints, true);
+		report("compose() std::vector<int32_t> multi-line", measurement, intText.size());
+	}
+	// 25 significant digits always take the digit loop, which needs the standard floating-point environment.
+	Numbstrict::String longDigits;
+	for (int i = 0; i < COUNT; ++i) {
+		Numbstrict::String number(buffer, Numbstrict::doubleToChars(doubles[i], buffer));
+		number.insert(std::min(number.find('e'), number.size()), "00000001");
+		longDigits += number;
+		longDigits += ' ';
+	}
+	for (int scoped = 0; scoped < 2; ++scoped) {
+		Measurement measurement;
+		std::unique_ptr<Numbstrict::RealConversionScope> scope(scoped != 0 ? new Numbstrict::RealConversionScope() : 0);
+		double sum = 0.0;
+		const Numbstrict::Char* end = longDigits.data() + longDigits.size();
+		for (const Numbstrict::Char* p = longDigits.data(); p < end; ++p) {
+			sum += Numbstrict::charsToDouble(p, end, &p);
+		}
+		report((scoped != 0 ? "charsToDouble() 25 digits, scoped" : "charsToDouble() 25 digits")
+				, measurement, longDigits.size());
+		if (sum == 0.0) {
+			std::cout << "(zero sum)" << std::endl;
+		}
+	}
+}
+
+// A chain of `depth` structs, each with a few leaf members and the next one as `child`.
+static void benchmarkDeep() {
+	const int DEPTHS[] = { 250, 500, 1000, 2000 };
+	for (size_t i = 0; i < sizeof (DEPTHS) / sizeof (*DEPTHS); ++i) {
+		const int depth = DEPTHS[i];
+		size_t bytes = 0;
+		Numbstrict::String text;
+		{
+			Measurement measurement;
+			Numbstrict::Element child("leaf");
+			for (int level = depth - 1; level >= 0; --level) {
+				Numbstrict::Struct structure;
+				structure["level"] = Numbstrict::Element(Numbstrict::compose(level));
+				structure["name"] = Numbstrict::Element(Numbstrict::compose("level " + Numbstrict::intToString(level)));
+				structure["child"] = child;
+				child = Numbstrict::Element(Numbstrict::compose(structure, true));
+			}
+			text = child.code();
+			bytes = text.size();
+			report(("nested compose(), depth " + Numbstrict::intToString(depth)).c_str(), measurement, bytes);
+		}
+		{
+			const Numbstrict::Struct parsed = Numbstrict::Element(text).to<Numbstrict::Struct>();
+			Measurement measurement;
+			const size_t size = Numbstrict::compose(parsed, true).size();
+			report(("compose() parsed top level, depth " + Numbstrict::intToString(depth)).c_str(), measurement, size);
+		}
+		{
+			Measurement measurement;
+			CountingSink sink;
+			Numbstrict::Composer composer(sink, true);
+			for (int level = 0; level < depth; ++level) {
+				composer.beginStruct().key("child");
+			}
+			composer.value(Numbstrict::Element("leaf"));
+			for (int level = depth - 1; level >= 0; --level) {
+				composer.key("level").value(level).key("name").value("level " + Numbstrict::intToString(level));
+				composer.endStruct();
+			}
+			composer.flush();
+			report(("Composer, depth " + Numbstrict::intToString(depth)).c_str(), measurement, sink.count);
+			assert(sink.count == bytes);
+		}
+	}
+}
+
+struct Record {
+	Record() : id(0), weight(0.0), count(0) { }
+	int32_t id;
+	Numbstrict::String name;
+	double weight;
+	uint16_t count;
+};
+NUMBSTRICT_FIELDS(Record, id, name, weight, count)
+
+struct Reading {
+	Reading() : time(0), sensor(0), temperature(0), humidity(0), pressure(0), voltage(0), current(0), power(0)
+			, frequency(0), phase(0), status(0), errors(0), minimum(0), maximum(0), average(0), samples(0) { }
+	int64_t time;
+	int32_t sensor;
+	int32_t temperature;
+	int32_t humidity;
+	int32_t pressure;
+	int32_t voltage;
+	int32_t current;
+	int32_t power;
+	int32_t frequency;
+	int32_t phase;
+	int32_t status;
+	int32_t errors;
+	int32_t minimum;
+	int32_t maximum;
+	int32_t average;
+	int32_t samples;
+};
+NUMBSTRICT_FIELDS(Reading, time, sensor, temperature, humidity, pressure, voltage, current, power, frequency, phase
+		, status, errors, minimum, maximum, average, samples)
+
+// 1M records bound with NUMBSTRICT_FIELDS versus going through a Struct per record.
+static void benchmarkFields() {
+	const int COUNT = 1000000;
+	std::vector<Record> records(COUNT);
+	for (int i = 0; i < COUNT; ++i) {
+		records[i].id = i;
+		records[i].name = "item " + Numbstrict::intToString(i);
+		records[i].weight = i * 0.25;
+		records[i].count = static_cast<uint16_t>(i);
+	}
+	Numbstrict::String text;
+	{
+		Measurement measurement;
+		text = Numbstrict::compose(records, true);
+		report("compose() bound records", measurement, text.size());
+	}
+	{
+		Measurement measurement;
+		const Numbstrict::Array array = Numbstrict::Element(text).to<Numbstrict::Array>();
+		std::vector<Record> parsed(array.size());
+		for (size_t i = 0; i < array.size(); ++i) {
+			const Numbstrict::Struct structure = array[i].to<Numbstrict::Struct>();
+			parsed[i].id = structure.find("id")->second.to<int32_t>();
+			parsed[i].name = structure.find("name")->second.to<Numbstrict::String>();
+			parsed[i].weight = structure.find("weight")->second.to<double>();
+			parsed[i].count = structure.find("count")->second.to<uint16_t>();
+		}
+		report("Struct per record, find() and to<T>()", measurement, text.size());
+	}
+	{
+		Measurement measurement;
+		const Numbstrict::Array array = Numbstrict::Element(text).to<Numbstrict::Array>();
+		std::vector<Record> parsed(array.size());
+		for (size_t i = 0; i < array.size(); ++i) {
+			typedef Numbstrict::Fields<Record> Keys;
+			const Numbstrict::KeySlots<Keys> slots = array[i].to< Numbstrict::KeySlots<Keys> >();
+			parsed[i].id = slots[0].to<int32_t>();
+			parsed[i].name = slots[1].to<Numbstrict::String>();
+			parsed[i].weight = slots[2].to<double>();
+			parsed[i].count = slots[3].to<uint16_t>();
+		}
+		report("KeySlots per record and to<T>()", measurement, text.size());
+	}
+	{
+		Measurement measurement;
+		const std::vector<Record> parsed = Numbstrict::Element(text).to< std::vector<Record> >();
+		report("to< std::vector<Record> >() bound", measurement, text.size());
+	}
+	{
+		std::vector<Reading> readings(COUNT / 4);
+		for (size_t i = 0; i < readings.size(); ++i) {
+			readings[i].time = 1700000000000LL + i;
+			readings[i].sensor = static_cast<int32_t>(i % 100);
+		}
+		const Numbstrict::String readingsText = Numbstrict::compose(readings, true);
+		Measurement measurement;
+		const std::vector<Reading> parsed = Numbstrict::Element(readingsText).to< std::vector<Reading> >();
+		report("to< std::vector<Reading> >() bound, 16 fields", measurement, readingsText.size());
+	}
+}
+
+// The hand-written check that a Schema replaces: to<Variant>() on every element of the tree.
+static bool variantHasType(const Numbstrict::WideStruct& members, const wchar_t* key, Numbstrict::Variant::Type type
+		, bool optional = false) {
+	const Numbstrict::WideStruct::const_iterator it = members.find(key);
+	return (it == members.end() ? optional : it->second.to<Numbstrict::Variant>().type() == type);
+}
+
+static bool checkRecordsWithVariants(const Numbstrict::Element& element) {
+	const Numbstrict::Variant root = element.to<Numbstrict::Variant>();
+	if (root.type() != Numbstrict::Variant::ARRAY) {
+		return false;
+	}
+	for (Numbstrict::Array::const_iterator it = root.array().begin(); it != root.array().end(); ++it) {
+		const Numbstrict::Variant record = it->to<Numbstrict::Variant>();
+		if (record.type() != Numbstrict::Variant::STRUCT || record.structure().size() != 4
+				|| !variantHasType(record.structure(), L"name", Numbstrict::Variant::TEXT)
+				|| !variantHasType(record.structure(), L"weight", Numbstrict::Variant::REAL)) {
+			return false;
+		}
+		const Numbstrict::Variant size = record.structure().find(L"size")->second.to<Numbstrict::Variant>();
+		if (size.type() != Numbstrict::Variant::INTEGER || size.integer() < 0 || size.integer() > 1000000) {
+			return false;
+		}
+		const Numbstrict::Variant tags = record.structure().find(L"tags")->second.to<Numbstrict::Variant>();
+		if (tags.type() != Numbstrict::Variant::ARRAY) {
+			return false;
+		}
+		for (Numbstrict::Array::const_iterator tag = tags.array().begin(); tag != tags.array().end(); ++tag) {
+			if (tag->to<Numbstrict::Variant>().type() != Numbstrict::Variant::TEXT) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+// 200k records checked by walking Variants versus a Schema, for a valid source and one with an error up front.
+static void benchmarkSchema() {
+	const Numbstrict::Schema schema(Numbstrict::Element(Numbstrict::String("{ type: array, elements: {\n"
+			"\ttype: struct\n"
+			"\tmembers: {\n"
+			"\t\tname: text\n"
+			"\t\tsize: { type: integer, min: 0, max: 1000000 }\n"
+			"\t\tweight: real\n"
+			"\t\ttags: { type: array, elements: text }\n"
+			"\t}\n"
+			"} }"), "schema"));
+	Numbstrict::String valid = "{\n";
+	for (int i = 0; i < 200000; ++i) {
+		valid += "\t{ name: \"record " + Numbstrict::intToString(i) + "\", size: " + Numbstrict::intToString(i)
+				+ ", weight: " + Numbstrict::doubleToString(i * 0.5) + ", tags: { alpha, beta } }\n";
+	}
+	valid += "}\n";
+	Numbstrict::String invalid = valid;
+	invalid.replace(invalid.find("size: 0"), 7, "size: x");
+	const Numbstrict::Element sources[2] = { Numbstrict::Element(valid, "valid")
+			, Numbstrict::Element(invalid, "invalid") };
+	for (int i = 0; i < 2; ++i) {
+		const Numbstrict::String prefix = Numbstrict::String(i == 0 ? "valid" : "invalid") + " source, ";
+		const size_t bytes = (i == 0 ? valid.size() : 0);	// the invalid source is not read to the end
+		{
+			Measurement measurement;
+			const bool ok = checkRecordsWithVariants(sources[i]);
+			report((prefix + "to<Variant>() walk").c_str(), measurement, bytes);
+			if (ok != (i == 0)) {
+				std::cout << "variant check failed" << std::endl;
+			}
+		}
+		{
+			Measurement measurement;
+			size_t failOffset = 0;
+			const bool ok = schema.tryToValidate(sources[i], failOffset);
+			report((prefix + "Schema::tryToValidate()").c_str(), measurement, bytes);
+			if (ok != (i == 0)) {
+				std::cout << "schema check failed" << std::endl;
+			}
+		}
+	}
+}
+
+// 1M scalars (integers, reals, booleans and short texts) parsed to Variants, kept in a vector or reusing one Variant.
+static void benchmarkVariants() {
+	const int COUNT = 1000000;
+	Numbstrict::String source = "{\n";
+	for (int i = 0; i < COUNT; ++i) {
+		switch (i % 4) {
+			case 0: source += Numbstrict::intToString(i); break;
+			case 1: source += Numbstrict::doubleToString(i * 0.5); break;
+			case 2: source += (i % 8 == 2 ? "true" : "false"); break;
+			case 3: source += "\"t" + Numbstrict::intToString(i % 10) + '\"'; break;
+		}
+		source += '\n';
+	}
+	source += "}\n";
+	const Numbstrict::Array elements = Numbstrict::Element(source, "variants").to<Numbstrict::Array>();
+	{
+		Measurement measurement;
+		std::vector<Numbstrict::Variant> variants(elements.size());
+		for (size_t i = 0; i < elements.size(); ++i) {
+			Numbstrict::Parser(elements[i]).parse(variants[i]);
+		}
+		report("to<Variant>() of scalars, kept", measurement, source.size());
+		std::cout << "sizeof (Variant) " << sizeof (Numbstrict::Variant) << " bytes, "
+				<< measurement.allocatedBytes() / elements.size() << " bytes allocated per scalar" << std::endl;
+	}
+	{
+		Measurement measurement;
+		Numbstrict::Variant variant;
+		for (size_t i = 0; i < elements.size(); ++i) {
+			Numbstrict::Parser(elements[i]).parse(variant);
+		}
+		report("to<Variant>() of scalars, one Variant reused", measurement, source.size());
+	}
+}
+
+static size_t walkVariants(const Numbstrict::Element& element) {	// returns the number of values
+	Numbstrict::Variant variant;
+	Numbstrict::Parser(element).parse(variant);
+	size_t count = 1;
+	if (variant.type() == Numbstrict::Variant::STRUCT) {
+		const Numbstrict::WideStruct& members = variant.structure();
+		for (Numbstrict::WideStruct::const_iterator it = members.begin(); it != members.end(); ++it) {
+			count += walkVariants(it->second);
+		}
+	} else if (variant.type() == Numbstrict::Variant::ARRAY) {
+		const Numbstrict::Array& elements = variant.array();
+		for (Numbstrict::Array::const_iterator it = elements.begin(); it != elements.end(); ++it) {
+			count += walkVariants(*it);
+		}
+	}
+	return count;
+}
+
+// Every value of a deeply nested struct-of-struct classified through to<Variant>(), level by level.
+static void benchmarkVariantTree() {
+	const int DEPTHS[] = { 50, 100, 200 };
+	for (size_t i = 0; i < sizeof (DEPTHS) / sizeof (*DEPTHS); ++i) {
+		const Numbstrict::String source = generateNested(DEPTHS[i], 40);
+		Measurement measurement;
+		const size_t count = walkVariants(Numbstrict::Element(source));
+		report(("to<Variant>() of every value, depth " + Numbstrict::intToString(DEPTHS[i])).c_str(), measurement
+				, source.size());
+		std::cout << count << " values" << std::endl;
+	}
+}
+
+struct Benchmark {
+	const char* name;
+	void (*function)();
+};
+
+static const Benchmark BENCHMARKS[] = {
+	{ "allocations", benchmarkAllocations },
+	{ "keys", benchmarkKeys },
+	{ "containers", benchmarkContainers },
+	{ "white", benchmarkWhite },
+	{ "index", benchmarkIndex },
+	{ "lazy", benchmarkLazy },
+	{ "stream", benchmarkStream },
+	{ "lines", benchmarkLines },
+	{ "parallel", benchmarkParallel },
+	{ "composeParallel", benchmarkComposeParallel },
+	{ "composer", benchmarkComposer },
+	{ "deep", benchmarkDeep },
+	{ "reals", benchmarkReals },
+	{ "fields", benchmarkFields },
+	{ "schema", benchmarkSchema },
+	{ "variants", benchmarkVariants },
+	{ "variantTree", benchmarkVariantTree }
+};
+
+int main(int argc, const char* argv[]) {
+	const int count = sizeof (BENCHMARKS) / sizeof (*BENCHMARKS);
+	for (int i = 0; i < count; ++i) {
+		bool run = (argc < 2);
+		for (int j = 1; j < argc; ++j) {
+			run = run || (strcmp(argv[j], BENCHMARKS[i].name) == 0);
+		}
+		if (run) {
+			std::cout << "---- " << BENCHMARKS[i].name << std::endl;
+			BENCHMARKS[i].function();
+		}
+	}
+	return 0;
+}
@@ -20,14 +20,14 @@ int numbstrictTest(const std::string& source) {
 //	Numbstrict::Struct m = Numbstrict::Element(source).to<Numbstrict::Struct>();
 
 	Numbstrict::Variant v = Numbstrict::Element(source).to<Numbstrict::Variant>();
-	switch (v.type) {
+	switch (v.type()) {
 		case Numbstrict::Variant::INVALID: std::cout << "INVALID" << std::endl; break;
-		case Numbstrict::Variant::STRUCT: std::cout << "STRUCT(" << v.array.size() << ") " << Numbstrict::compose(v.structure, true) << std::endl; break;
-		case Numbstrict::Variant::ARRAY: std::cout << "ARRAY (" << v.array.size() << ") " << Numbstrict::compose(v.array, true) << std::endl; break;
-		case Numbstrict::Variant::TEXT: std::cout << "TEXT: " << Numbstrict::compose(v.text, true) << std::endl; break;
-		case Numbstrict::Variant::REAL: std::cout << "REAL: " << Numbstrict::compose(v.real) << std::endl; break;
-		case Numbstrict::Variant::INTEGER: std::cout << "INTEGER: " << Numbstrict::compose(v.integer, false) << std::endl; break;
-		case Numbstrict::Variant::BOOLEAN: std::cout << "BOOLEAN: " << Numbstrict::compose(v.boolean) << std::endl; break;
+		case Numbstrict::Variant::STRUCT: std::cout << "STRUCT(" << v.structure().size() << ") " << Numbstrict::compose(v.structure(), true) << std::endl; break;
+		case Numbstrict::Variant::ARRAY: std::cout << "ARRAY (" << v.array().size() << ") " << Numbstrict::compose(v.array(), true) << std::endl; break;
+		case Numbstrict::Variant::TEXT: std::cout << "TEXT: " << Numbstrict::compose(v.text(), true) << std::endl; break;
+		case Numbstrict::Variant::REAL: std::cout << "REAL: " << Numbstrict::compose(v.real()) << std::endl; break;
+		case Numbstrict::Variant::INTEGER: std::cout << "INTEGER: " << Numbstrict::compose(v.integer(), false) << std::endl; break;
+		case Numbstrict::Variant::BOOLEAN: std::cout << "BOOLEAN: " << Numbstrict::compose(v.boolean()) << std::endl; break;
 	}
 #if 0
 	Numbstrict::Array array;
@@ -411,15 +411,15 @@ static void deepParse(const Numbstrict::Element& element) {
 	}
 	assert(backAgain == andAgain);
 
-	switch (var.type) {
+	switch (var.type()) {
 		case Numbstrict::Variant::STRUCT: {
-			for (Numbstrict::Struct::const_iterator it = var.structure.begin(); it != var.structure.end(); ++it) {
+			for (Numbstrict::Struct::const_iterator it = var.structure().begin(); it != var.structure().end(); ++it) {
 				deepParse(it->second);
 			}
 			break;
 		}
 		case Numbstrict::Variant::ARRAY: {
-			for (Numbstrict::Array::const_iterator it = var.array.begin(); it != var.array.end(); ++it) {
+			for (Numbstrict::Array::const_iterator it = var.array().begin(); it != var.array().end(); ++it) {
 				deepParse(*it);
 			}
 			break;
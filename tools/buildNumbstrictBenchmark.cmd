@@ -0,0 +1,7 @@
+@ECHO OFF
+SETLOCAL
+CD /D "%~dp0"
+CALL BuildCpp.cmd release x64 NumbstrictBenchmark.exe -I ..\src NumbstrictBenchmark.cpp ..\src\Numbstrict.cpp || GOTO error
+EXIT /b 0
+:error
+EXIT /b %ERRORLEVEL%
@@ -0,0 +1,4 @@
+#!/usr/bin/env bash
+set -e -o pipefail -u
+cd "$(dirname "$0")"
+bash BuildCpp.sh release x64 NumbstrictBenchmark -I ../src/ NumbstrictBenchmark.cpp ../src/Numbstrict.cpp